@@ -167,7 +167,7 @@ public class ConfigForm extends Form {
         cm.setBaseDir(Paths.get(baseDir).toString() + 
                 FileSystems.getDefault().getSeparator());
         cm.setPathsCache(
-                Paths.get(baseDir, "output", "path-cache.csv").toString());
+                Paths.get(baseDir, "output", "path-cache.bin").toString());
 
         cm.writeToFile();
     }
@@ -13,12 +13,9 @@
 
 int main(int argc, char* argv[]) {
 
-    // Load Appropriate Data
-    DataLoader dl(argv[1]);
-    
-    // Note that new entities should have already been created
-    dl.loadEvents();
-    dl.loadPeople();
+    // Load Appropriate Data (with the events and people; note that new 
+    // entities should have already been created)
+    DataLoader dl(argv[1], true);
     
     // Print out data if desired
     std::cout << dl << std::endl;
@@ -0,0 +1,115 @@
+#ifndef DATALOADER_CLOSURESLOADER_HPP
+#define DATALOADER_CLOSURESLOADER_HPP
+
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "../include/rapidjson/document.h"
+
+#include "../model/Closure.hpp"
+
+#include "../utils/Typedefs.hpp"
+#include "../utils/DateUtils.hpp"
+#include "../utils/IOUtils.hpp"
+#include "../utils/Snapshot.hpp"
+
+class ClosuresLoader {
+public:
+
+    // Constructors
+    ClosuresLoader();
+    explicit ClosuresLoader(const Filename& fname);
+
+    // Queries
+    int size() const;
+    const std::vector<Closure>& getClosures() const;
+
+    // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
+    friend std::ostream& operator<<(
+            std::ostream& oss, 
+            const ClosuresLoader& cl);
+
+private:
+
+    // A list of closures
+    std::vector<Closure> entries;
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// Constructors
+
+// Default Constructor
+ClosuresLoader::ClosuresLoader() {}
+
+// For the given closures file, read and load each closure
+ClosuresLoader::ClosuresLoader(const Filename& fname) {
+    if (fname == "none")
+        return;
+
+    std::cout << "... Reading Closures file: " << fname << std::endl;
+
+    // JSON reader setup
+    rj::Document doc;
+    openJSON(fname, doc);
+    entries.reserve(doc.Size());
+
+    for (const rj::Value& v : doc.GetArray()) {
+
+        // Initialize a closure
+        Closure c;
+
+        // space-id, neighbor-id
+        c.sid = parseInt(v, "space-id");
+        c.nid = parseInt(v, "neighbor-id", -1);
+
+        // start, end
+        c.start = DateTime{parseStr(v, "start")};
+        c.end   = DateTime{parseStr(v, "end")};
+        if (c.end <= c.start) {
+            std::cerr << "ClosuresLoader Error: " << c 
+                      << " must end after it starts" << std::endl;
+            exitOnError();
+        }
+
+        entries.push_back(c);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// Queries
+
+// Return the number of closures
+int ClosuresLoader::size() const { return entries.size(); }
+
+// Return the list of closures
+const std::vector<Closure>& ClosuresLoader::getClosures() const 
+{ return entries; }
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// I/O
+
+// Write the closures into the snapshot
+void ClosuresLoader::save(SnapshotWriter& w) const 
+{ w.put(entries); }
+
+// Read the closures from the snapshot
+void ClosuresLoader::load(SnapshotReader& r) 
+{ r.get(entries); }
+
+// Print the closures
+std::ostream& operator<<(std::ostream& oss, const ClosuresLoader& cl) {
+    oss << "Closures:" << std::endl;
+    for (const Closure& c : cl.entries)
+        oss << "  " << c << std::endl;
+    return oss;
+}
+
+#endif // DATALOADER_CLOSURESLOADER_HPP
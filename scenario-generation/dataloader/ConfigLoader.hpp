@@ -9,6 +9,7 @@
 #include <utility>
 
 #include "../utils/Typedefs.hpp"
+#include "../utils/IOUtils.hpp"
 
 namespace {
 
@@ -167,14 +168,14 @@ std::ostream& operator<<(std::ostream& oss, const ConfigLoader& c) {
 // Should be called when a given section does not exist
 void ConfigLoader::sectionError(const Section& s) const {
     std::cerr << "ConfigError: section `" << s << "` not found" << std::endl;
-    std::exit(1);
+    exitOnError();
 }
 
 // Should be called when a given option in a specified section does not exist
 void ConfigLoader::optionError(const Section& s, const Option& o) const {
     std::cerr << "ConfigError: section.option `" << s << "." << o 
               << "` not found" << std::endl;
-    std::exit(1);
+    exitOnError();
 }
 
 #endif // DATALOADER_CONFIG_LOADER_HPP
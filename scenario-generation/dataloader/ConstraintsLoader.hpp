@@ -5,6 +5,8 @@
 #include <string>
 #include <vector>
 #include <utility>
+#include <cstdint>
+#include <algorithm>
 
 #include "../include/rapidjson/document.h"
 
@@ -20,6 +22,8 @@
 #include "../utils/DateUtils.hpp"
 #include "../utils/IOUtils.hpp"
 #include "../utils/TimeProfile.hpp"
+#include "../utils/EventLogistics.hpp"
+#include "../utils/Snapshot.hpp"
 
 #include "SpacesLoader.hpp"
 #include "EventsLoader.hpp"
@@ -27,6 +31,75 @@
 #include "MetaEventsLoader.hpp"
 #include "MetaPeopleLoader.hpp"
 
+// A set of ids, for fast membership tests: ids in [0, maxBit) are bits of a 
+// bitmap, and larger (or negative) ids are only flagged as present, so that 
+// they are conservatively taken to be members
+class IDBitmap {
+public:
+
+    // Queries
+    bool contains(int id) const;
+
+    // Modifiers
+    void insert(int id);
+
+    // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
+
+private:
+
+    // The largest bitmap
+    static const int maxBit = 1 << 24;
+
+    std::vector<bool> bits;
+    bool negative = false;
+    bool large = false;
+
+};
+
+// Return false only if the id was not inserted
+bool IDBitmap::contains(int id) const {
+    if (id < 0)
+        return negative;
+    if (id >= maxBit)
+        return large;
+    return (std::size_t) id < bits.size() && bits[id];
+}
+
+// Insert the id
+void IDBitmap::insert(int id) {
+    if (id < 0)
+        negative = true;
+    else if (id >= maxBit)
+        large = true;
+    else {
+        if ((std::size_t) id >= bits.size())
+            bits.resize(id+1, false);
+        bits[id] = true;
+    }
+}
+
+// Write the bitmap into the snapshot
+void IDBitmap::save(SnapshotWriter& w) const { w.put(bits, negative, large); }
+
+// Read the bitmap from the snapshot
+void IDBitmap::load(SnapshotReader& r) { r.get(bits, negative, large); }
+
+// The ids in the first and second parts of the keys of a kind of constraints
+typedef std::pair<IDBitmap, IDBitmap> KeyBitmaps;
+
+// A compiled space-person (or space-metaperson) constraint: the events it 
+// requires (as bits, by event slot), the range of the number of attended 
+// events of each metaevent it requires (by metaevent slot), and its time 
+// profile
+struct SpacePersonRule {
+    std::vector<std::uint64_t> requiredBits;
+    std::vector<std::pair<Index, CapRange>> requiredCounts;
+    bool isActiveTP;
+    TimeProfileRef tp;
+};
+
 class ConstraintsLoader {
 public:
 
@@ -35,18 +108,24 @@ public:
     explicit ConstraintsLoader(const Filename& fname);
 
     // Queries
-    bool checkCPConstraints(SpaceID cid, PersonID pid, const DateTime& curr);
+    bool checkCPConstraints(SpaceID cid, const Person& p, const DateTime& curr);
     bool checkCEConstraints(SpaceID cid, EventID eid, const DateTime& curr);
-    bool checkPEConstraints(PersonID pid, EventID eid, const DateTime& curr);
-
-    bool checkCP(SpaceID cid, PersonID pid, const DateTime& curr);
-    bool checkCMP(SpaceID cid, PersonID mpid, const DateTime& curr);
+    bool checkPEConstraints(const Person& p, EventID eid, const DateTime& curr);
+    std::vector<std::uint64_t> checkConstraints(
+            const Person& p, 
+            const DateTime& curr, 
+            const std::vector<CEKey>& cands);
+
+    bool checkCP(SpaceID cid, const Person& p, const DateTime& curr);
+    bool checkCMP(SpaceID cid, const Person& p, const DateTime& curr);
     bool checkCE(SpaceID cid, EventID eid, const DateTime& curr);
     bool checkCME(SpaceID cid, EventID meid, const DateTime& curr);
-    bool checkPE(PersonID pid, EventID eid, const DateTime& curr);
-    bool checkPME(PersonID pid, EventID meid, const DateTime& curr);
-    bool checkMPE(PersonID mpid, EventID eid, const DateTime& curr);
-    bool checkMPME(PersonID mpid, EventID meid, const DateTime& curr);
+    bool checkPE(const Person& p, EventID eid, const DateTime& curr);
+    bool checkPME(const Person& p, EventID meid, const DateTime& curr);
+    bool checkMPE(const Person& p, EventID eid, const DateTime& curr);
+    bool checkMPME(const Person& p, EventID meid, const DateTime& curr);
+
+    void addAttendance(Person& p, const EventLogistics& el) const;
 
     // Modifiers
     void addCP(SpacePersonConstraint cpc);
@@ -59,20 +138,27 @@ public:
     void addMPME(PersonEventConstraint pec);
 
     void addSpaces(SpacesLoader& C) { this->C = C; }
-    void addPeople(PeopleLoader& P) { this->P = P; }
     void addEvents(EventsLoader& E) { this->E = E; }
     void addMetaPeople(MetaPeopleLoader& MP) { this->MP = MP; }
     void addMetaEvents(MetaEventsLoader& ME) { this->ME = ME; }
+    void compile();
 
+    // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     friend std::ostream& operator<<(std::ostream& oss, 
                                     const ConstraintsLoader& csl);
 
 private:
 
+    // Private helper methods
+    Index compileRule(const SpacePersonConstraint& c);
+    bool checkRule(const SpacePersonRule& r, const Person& p, 
+                   const DateTime& curr) const;
+
     // References to relevant entities
     SpacesLoader C;
     EventsLoader E;
-    PeopleLoader P;
     MetaEventsLoader ME;
     MetaPeopleLoader MP;
 
@@ -100,6 +186,29 @@ private:
     // MetaPerson-MetaEvent constraints
     std::map<MPMEKey, PersonEventConstraint> mpmecEntries;
 
+    // The ids in the keys of each kind of constraints, to skip looking up 
+    // the entities and constraints when no constraint can apply
+    KeyBitmaps cpcKeys;
+    KeyBitmaps cmpcKeys;
+    KeyBitmaps cecKeys;
+    KeyBitmaps cmecKeys;
+    KeyBitmaps pecKeys;
+    KeyBitmaps pmecKeys;
+    KeyBitmaps mpecKeys;
+    KeyBitmaps mpmecKeys;
+
+    // The space-person and space-metaperson constraints, compiled into 
+    // rules: the rule of each (space, metaperson) by dense indices (or -1), 
+    // and of each (space, person) with a constraint
+    std::vector<SpacePersonRule> rules;
+    IndexList cmpRuleOf;
+    std::map<CPKey, Index> cpRuleOf;
+
+    // The slots of the events and metaevents required by the rules, i.e., 
+    // the bits and counters of the attendance of people (see addAttendance)
+    std::map<EventID, Index> eventSlot;
+    std::map<MetaEventID, Index> metaEventSlot;
+
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -150,7 +259,8 @@ ConstraintsLoader::ConstraintsLoader(const Filename& fname) {
             }
 
             // time-profile
-            if (v.HasMember("time-profile")) c.setTimeProfile(TimeProfile{v["time-profile"]});
+            if (v.HasMember("time-profile"))
+                c.setTimeProfile(TimeProfileRef{v["time-profile"]});
 
             // Add the constraint to the data loader
             addCP(c);
@@ -185,7 +295,7 @@ ConstraintsLoader::ConstraintsLoader(const Filename& fname) {
 
             // time-profile
             if (v.HasMember("time-profile"))
-                c.setTimeProfile(TimeProfile{v["time-profile"]});
+                c.setTimeProfile(TimeProfileRef{v["time-profile"]});
 
             // Add the constraint to the data loader
             addCMP(c);
@@ -205,7 +315,7 @@ ConstraintsLoader::ConstraintsLoader(const Filename& fname) {
 
             // time-profile
             if (v.HasMember("time-profile"))
-                c.setTimeProfile(TimeProfile{v["time-profile"]});
+                c.setTimeProfile(TimeProfileRef{v["time-profile"]});
 
             // capacity
             if (v.HasMember("capacity")) {
@@ -231,7 +341,7 @@ ConstraintsLoader::ConstraintsLoader(const Filename& fname) {
 
             // time-profile
             if (v.HasMember("time-profile"))
-                c.setTimeProfile(TimeProfile{v["time-profile"]});
+                c.setTimeProfile(TimeProfileRef{v["time-profile"]});
 
             // capacity
             if (v.HasMember("capacity")) {
@@ -367,9 +477,9 @@ ConstraintsLoader::ConstraintsLoader(const Filename& fname) {
 // Queries
 
 // Check all space-person constraints
-bool ConstraintsLoader::checkCPConstraints(SpaceID cid, PersonID pid, 
+bool ConstraintsLoader::checkCPConstraints(SpaceID cid, const Person& p, 
         const DateTime& curr) 
-{ return checkCP(cid,pid,curr) && checkCMP(cid,pid,curr); }
+{ return checkCP(cid,p,curr) && checkCMP(cid,p,curr); }
 
 // Check all space-event constraints
 bool ConstraintsLoader::checkCEConstraints(SpaceID cid, EventID eid,
@@ -377,105 +487,100 @@ bool ConstraintsLoader::checkCEConstraints(SpaceID cid, EventID eid,
 { return checkCE(cid,eid,curr) && checkCME(cid,eid,curr); }
 
 // Check all person-event constraints
-bool ConstraintsLoader::checkPEConstraints(PersonID pid, EventID eid,
+bool ConstraintsLoader::checkPEConstraints(const Person& p, EventID eid,
         const DateTime& curr) {
-    return checkPE(pid,eid,curr) && checkPME(pid,eid,curr) && 
-           checkMPE(pid,eid,curr) && checkMPME(pid,eid,curr);
+    return checkPE(p,eid,curr) && checkPME(p,eid,curr) && 
+           checkMPE(p,eid,curr) && checkMPME(p,eid,curr);
+}
+
+// Check all constraints of each candidate (space, event) pair for the person 
+// at datetime curr, and return a bitmask of the admissible candidates (bit 
+// i%64 of word i/64 is set if candidate i is admissible). The person and its 
+// metaperson are looked up in the key bitmaps once, then the candidates are 
+// screened by the key bitmaps of their spaces and events, so that only the 
+// candidates that may be constrained are checked in full.
+std::vector<std::uint64_t> ConstraintsLoader::checkConstraints(
+        const Person& p, 
+        const DateTime& curr, 
+        const std::vector<CEKey>& cands) {
+    std::size_t n = cands.size();
+
+    // The kinds of constraints that may apply to the person
+    bool cp   = cpcKeys.second.contains(p.id);
+    bool cmp  = cmpcKeys.second.contains(p.mid);
+    bool pe   = pecKeys.first.contains(p.id);
+    bool pme  = pmecKeys.first.contains(p.id);
+    bool mpe  = mpecKeys.first.contains(p.mid);
+    bool mpme = mpmecKeys.first.contains(p.mid);
+
+    // Screen the spaces and events of the candidates
+    std::vector<char> bySpace(n), byEvent(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        SpaceID cid = cands[i].first;
+        bySpace[i] = (cp && cpcKeys.first.contains(cid)) || 
+                     (cmp && cmpcKeys.first.contains(cid)) || 
+                     cecKeys.first.contains(cid) || 
+                     cmecKeys.first.contains(cid);
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        EventID eid = cands[i].second;
+        byEvent[i] = pme || mpme || 
+                     (pe && pecKeys.second.contains(eid)) || 
+                     (mpe && mpecKeys.second.contains(eid));
+    }
+
+    // Check the candidates that may be constrained in full
+    std::vector<std::uint64_t> mask((n + 63) / 64, 0);
+    for (std::size_t i = 0; i < n; ++i) {
+        SpaceID cid = cands[i].first;
+        EventID eid = cands[i].second;
+        bool ok = (!bySpace[i] || (checkCPConstraints(cid, p, curr) && 
+                                   checkCEConstraints(cid, eid, curr))) && 
+                  (!byEvent[i] || checkPEConstraints(p, eid, curr));
+        mask[i / 64] |= std::uint64_t{ok} << (i % 64);
+    }
+    return mask;
 }
 
 // Check space-person constraint
-bool ConstraintsLoader::checkCP(SpaceID cid, PersonID pid, 
+bool ConstraintsLoader::checkCP(SpaceID cid, const Person& p, 
         const DateTime& curr) {
 
-    // Get entities
-    Space&  c = C[cid];
-    Person& p = P[pid];
+    // No cp constraints exist for the space or person
+    if (!cpcKeys.first.contains(cid) || !cpcKeys.second.contains(p.id))
+        return true;
 
     // Find CP constraints
-    CPKey key = std::make_pair(cid, pid);
-    auto cit = cpcEntries.find(key);
-    if (cit == cpcEntries.end()) // no cp constraints exist
+    auto cit = cpRuleOf.find(std::make_pair(cid, p.id));
+    if (cit == cpRuleOf.end()) // no cp constraints exist
         return true;
 
-    // Get constraint 
-    SpacePersonConstraint& cs = cit->second;
-
-    // Check required events / metaevents
-    if (cs.whichEvent) { // required-event-ids
-        for (EventID x : cs.requiredEventIDs) {
-            if (p.attendedEventIDs.find(x) == p.attendedEventIDs.end())
-                return false;
-        }
-    } 
-    else { // required-metaevent-ids
-        for (const auto& x : cs.requiredMetaEventIDs) {
-            int count = p.attendedMetaEventIDs[x.first];
-            if ((x.second.first > count && x.second.first != -1) || 
-                (count > x.second.second && x.second.second != -1))
-                return false;
-        }
-    }
-
-    // Check time profile
-    if (cs.isActiveTP) {
-        TimePeriod period = cs.tp.query(curr, false);
-        if (!period)
-            return false;
-    }
-
-    return true;
+    return checkRule(rules[cit->second], p, curr);
 }
 
 // Check space-metaperson constraint
-bool ConstraintsLoader::checkCMP(SpaceID cid, PersonID pid,
+bool ConstraintsLoader::checkCMP(SpaceID cid, const Person& p,
         const DateTime& curr) {
 
-    // Get entities
-    Space&  c = C[cid];
-    Person& p = P[pid];
-
-    // Find CMP constraints
-    CMPKey key = std::make_pair(cid, p.mid);
-    auto cit = cmpcEntries.find(key);
-    if (cit == cmpcEntries.end()) // no cmp constraints exist
+    // No cmp constraints exist for the space or metaperson
+    if (!cmpcKeys.first.contains(cid) || !cmpcKeys.second.contains(p.mid))
         return true;
 
-    // Get constraint 
-    SpacePersonConstraint& cs = cit->second;
-
-    // Check required events / metaevents
-    if (cs.whichEvent) { // required-event-ids
-        for (EventID x : cs.requiredEventIDs) {
-            if (p.attendedEventIDs.find(x) == p.attendedEventIDs.end())
-                return false;
-        }
-    } 
-    else { // required-metaevent-ids
-        for (const auto& x : cs.requiredMetaEventIDs) {
-            int count = p.attendedMetaEventIDs[x.first];
-            if ((x.second.first > count && x.second.first != -1) || 
-                (count > x.second.second && x.second.second != -1))
-                return false;
-        }
-    }
-
-    // Check time profile
-    if (cs.isActiveTP) {
-        TimePeriod period = cs.tp.query(curr, false);
-        if (!period)
-            return false;
-    }
+    // Find CMP constraints, by dense space and metaperson indices
+    Index r = cmpRuleOf[C.getIndex(cid) * MP.size() + p.midx];
+    if (r == -1) // no cmp constraints exist
+        return true;
 
-    return true;
+    return checkRule(rules[r], p, curr);
 }
 
 // Check space-event constraint
 bool ConstraintsLoader::checkCE(SpaceID cid, EventID eid,
         const DateTime& curr) {
 
-    // Get entities
-    Space& c = C[cid];
-    Event& e = E[eid];
+    // No ce constraints exist for the space or event
+    if (!cecKeys.first.contains(cid) || !cecKeys.second.contains(eid))
+        return true;
 
     // Find CE constraints
     CEKey key = std::make_pair(cid, eid);
@@ -483,15 +588,13 @@ bool ConstraintsLoader::checkCE(SpaceID cid, EventID eid,
     if (cit == cecEntries.end()) // no constraints exist
         return true;
 
-    // Get constraint
+    // Get constraint and event
     SpaceEventConstraint& cs = cit->second;
+    Event& e = E[eid];
 
     // Check time profile
-    if (cs.isActiveTP) {
-        TimePeriod period = cs.tp.query(curr, false);
-        if (!period)
-            return false;
-    }
+    if (cs.isActiveTP && !cs.tp.active(curr))
+        return false;
 
     // Check capacity
     if (cs.isActiveCapacity) {
@@ -508,9 +611,12 @@ bool ConstraintsLoader::checkCE(SpaceID cid, EventID eid,
 bool ConstraintsLoader::checkCME(SpaceID cid, EventID eid,
         const DateTime& curr) {
 
-    // Get entities
-    Space& c = C[cid];
+    // No cme constraints exist for the space or metaevent
+    if (!cmecKeys.first.contains(cid))
+        return true;
     Event& e = E[eid];
+    if (!cmecKeys.second.contains(e.mid))
+        return true;
     
     // Find CME constraints
     CMEKey key = std::make_pair(cid, e.mid);
@@ -522,11 +628,8 @@ bool ConstraintsLoader::checkCME(SpaceID cid, EventID eid,
     SpaceEventConstraint& cs = cit->second;
 
     // Check time profile
-    if (cs.isActiveTP) {
-        TimePeriod period = cs.tp.query(curr, false);
-        if (!period)
-            return false;
-    }
+    if (cs.isActiveTP && !cs.tp.active(curr))
+        return false;
 
     // Check capacity
     if (cs.isActiveCapacity) {
@@ -540,15 +643,15 @@ bool ConstraintsLoader::checkCME(SpaceID cid, EventID eid,
 }
 
 // Check person-event constraint
-bool ConstraintsLoader::checkPE(PersonID pid, EventID eid,
+bool ConstraintsLoader::checkPE(const Person& p, EventID eid,
         const DateTime& curr) {
     
-    // Get entities
-    Person& p = P[pid];
-    Event&  e = E[eid];
+    // No pe constraints exist for the person or event
+    if (!pecKeys.first.contains(p.id) || !pecKeys.second.contains(eid))
+        return true;
 
     // Find PE constraints
-    PEKey key = std::make_pair(pid, eid);
+    PEKey key = std::make_pair(p.id, eid);
     auto cit = pecEntries.find(key);
     if (cit == pecEntries.end()) // no pe constraints exist
         return true;
@@ -564,15 +667,18 @@ bool ConstraintsLoader::checkPE(PersonID pid, EventID eid,
 }
 
 // Check person-metaevent constraint
-bool ConstraintsLoader::checkPME(PersonID pid, EventID eid,
+bool ConstraintsLoader::checkPME(const Person& p, EventID eid,
         const DateTime& curr) {
 
-    // Get entities
-    Person& p = P[pid];
-    Event&  e = E[eid];
+    // No pme constraints exist for the person or metaevent
+    if (!pmecKeys.first.contains(p.id))
+        return true;
+    Event& e = E[eid];
+    if (!pmecKeys.second.contains(e.mid))
+        return true;
 
     // Find PME constraints
-    PMEKey key = std::make_pair(pid, e.mid);
+    PMEKey key = std::make_pair(p.id, e.mid);
     auto cit = pmecEntries.find(key);
     if (cit == pmecEntries.end()) // no pme constraints exist
         return true;
@@ -588,12 +694,12 @@ bool ConstraintsLoader::checkPME(PersonID pid, EventID eid,
 }
 
 // Check metaperson-event constraint
-bool ConstraintsLoader::checkMPE(PersonID pid, EventID eid,
+bool ConstraintsLoader::checkMPE(const Person& p, EventID eid,
         const DateTime& curr) {
 
-    // Get entities
-    Person& p = P[pid];
-    Event&  e = E[eid];
+    // No mpe constraints exist for the metaperson or event
+    if (!mpecKeys.first.contains(p.mid) || !mpecKeys.second.contains(eid))
+        return true;
 
     // Find MPE constraints
     MPEKey key = std::make_pair(p.mid, eid);
@@ -612,12 +718,15 @@ bool ConstraintsLoader::checkMPE(PersonID pid, EventID eid,
 }
 
 // Check metaperson-metaevent constraint
-bool ConstraintsLoader::checkMPME(PersonID pid, EventID eid,
+bool ConstraintsLoader::checkMPME(const Person& p, EventID eid,
         const DateTime& curr) {
 
-    // Get entities
-    Person& p = P[pid];
-    Event&  e = E[eid];
+    // No mpme constraints exist for the metaperson or metaevent
+    if (!mpmecKeys.first.contains(p.mid))
+        return true;
+    Event& e = E[eid];
+    if (!mpmecKeys.second.contains(e.mid))
+        return true;
 
     // Find MPME constraints
     MPMEKey key = std::make_pair(p.mid, e.mid);
@@ -635,46 +744,186 @@ bool ConstraintsLoader::checkMPME(PersonID pid, EventID eid,
     return true;
 }
 
+// Record that the person attended the event in the event logistics, in the 
+// bits and counters of the events and metaevents required by the rules
+void ConstraintsLoader::addAttendance(
+        Person& p, 
+        const EventLogistics& el) const {
+    auto eit = eventSlot.find(el.eid);
+    if (eit != eventSlot.end()) {
+        std::size_t w = eit->second / 64;
+        if (w >= p.attendedBits.size())
+            p.attendedBits.resize(w+1, 0);
+        p.attendedBits[w] |= std::uint64_t{1} << (eit->second % 64);
+    }
+
+    auto mit = metaEventSlot.find(el.meid);
+    if (mit != metaEventSlot.end()) {
+        std::size_t m = mit->second;
+        if (m >= p.attendedCounts.size())
+            p.attendedCounts.resize(m+1, 0);
+        ++p.attendedCounts[m];
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 // Modifiers
 
+// Compile the space-person and space-metaperson constraints into rules, in 
+// a table by dense space and metaperson indices (after the spaces and 
+// metapeople are added). Constraints on unknown spaces or metapeople never 
+// apply.
+void ConstraintsLoader::compile() {
+    rules.clear();
+    cpRuleOf.clear();
+    eventSlot.clear();
+    metaEventSlot.clear();
+    cmpRuleOf.assign(C.size() * MP.size(), -1);
+
+    for (const auto& e : cpcEntries)
+        cpRuleOf[e.first] = compileRule(e.second);
+
+    const SpaceIDList& cids = C.getIDs();
+    const MetaPersonIDList& mpids = MP.getIDs();
+    for (const auto& e : cmpcEntries) {
+        if (std::find(cids.begin(), cids.end(), e.first.first) == cids.end() ||
+                std::find(mpids.begin(), mpids.end(), e.first.second) == 
+                mpids.end())
+            continue;
+        Index i = C.getIndex(e.first.first) * MP.size() + 
+                  MP.getIndex(e.first.second);
+        cmpRuleOf[i] = compileRule(e.second);
+    }
+}
+
 // Add a space-person constraint
-void ConstraintsLoader::addCP(SpacePersonConstraint cpc) 
-{ cpcEntries[std::make_pair(cpc.cid, cpc.pid)] = cpc; }
+void ConstraintsLoader::addCP(SpacePersonConstraint cpc) {
+    cpcEntries[std::make_pair(cpc.cid, cpc.pid)] = cpc;
+    cpcKeys.first.insert(cpc.cid);
+    cpcKeys.second.insert(cpc.pid);
+}
 
 // Add a space-metaperson constraint
-void ConstraintsLoader::addCMP(SpacePersonConstraint cpc) 
-{ cmpcEntries[std::make_pair(cpc.cid, cpc.mpid)] = cpc; }
+void ConstraintsLoader::addCMP(SpacePersonConstraint cpc) {
+    cmpcEntries[std::make_pair(cpc.cid, cpc.mpid)] = cpc;
+    cmpcKeys.first.insert(cpc.cid);
+    cmpcKeys.second.insert(cpc.mpid);
+}
 
 // Add a space-event constraint
-void ConstraintsLoader::addCE(SpaceEventConstraint cec) 
-{ cecEntries[std::make_pair(cec.cid, cec.eid)] = cec; }
+void ConstraintsLoader::addCE(SpaceEventConstraint cec) {
+    cecEntries[std::make_pair(cec.cid, cec.eid)] = cec;
+    cecKeys.first.insert(cec.cid);
+    cecKeys.second.insert(cec.eid);
+}
 
 // Add a space-metaevent constraint
-void ConstraintsLoader::addCME(SpaceEventConstraint cec) 
-{ cmecEntries[std::make_pair(cec.cid, cec.meid)] = cec; }
+void ConstraintsLoader::addCME(SpaceEventConstraint cec) {
+    cmecEntries[std::make_pair(cec.cid, cec.meid)] = cec;
+    cmecKeys.first.insert(cec.cid);
+    cmecKeys.second.insert(cec.meid);
+}
 
 // Add a person-event constraint
-void ConstraintsLoader::addPE(PersonEventConstraint pec) 
-{ pecEntries[std::make_pair(pec.pid, pec.eid)] = pec; }
+void ConstraintsLoader::addPE(PersonEventConstraint pec) {
+    pecEntries[std::make_pair(pec.pid, pec.eid)] = pec;
+    pecKeys.first.insert(pec.pid);
+    pecKeys.second.insert(pec.eid);
+}
 
 // Add a person-metaevent constraint
-void ConstraintsLoader::addPME(PersonEventConstraint pec) 
-{ pmecEntries[std::make_pair(pec.pid, pec.meid)] = pec; }
+void ConstraintsLoader::addPME(PersonEventConstraint pec) {
+    pmecEntries[std::make_pair(pec.pid, pec.meid)] = pec;
+    pmecKeys.first.insert(pec.pid);
+    pmecKeys.second.insert(pec.meid);
+}
 
 // Add a metaperson-event constraint
-void ConstraintsLoader::addMPE(PersonEventConstraint pec) 
-{ mpecEntries[std::make_pair(pec.mpid, pec.eid)] = pec; }
+void ConstraintsLoader::addMPE(PersonEventConstraint pec) {
+    mpecEntries[std::make_pair(pec.mpid, pec.eid)] = pec;
+    mpecKeys.first.insert(pec.mpid);
+    mpecKeys.second.insert(pec.eid);
+}
 
 // add a metaperson-metaevent constraint
-void ConstraintsLoader::addMPME(PersonEventConstraint pec) 
-{ mpmecEntries[std::make_pair(pec.mpid, pec.meid)] = pec; }
+void ConstraintsLoader::addMPME(PersonEventConstraint pec) {
+    mpmecEntries[std::make_pair(pec.mpid, pec.meid)] = pec;
+    mpmecKeys.first.insert(pec.mpid);
+    mpmecKeys.second.insert(pec.meid);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// Private Helpers
+
+// Compile the constraint into a rule (giving slots to the events and 
+// metaevents it requires), and return its index
+Index ConstraintsLoader::compileRule(const SpacePersonConstraint& c) {
+    SpacePersonRule r;
+    if (c.whichEvent) { // required-event-ids
+        for (EventID x : c.requiredEventIDs) {
+            std::size_t slot = eventSlot.emplace(x, eventSlot.size()).first->second;
+            if (slot / 64 >= r.requiredBits.size())
+                r.requiredBits.resize(slot / 64 + 1, 0);
+            r.requiredBits[slot / 64] |= std::uint64_t{1} << (slot % 64);
+        }
+    }
+    else { // required-metaevent-ids
+        for (const auto& x : c.requiredMetaEventIDs) {
+            auto it = metaEventSlot.emplace(x.first, metaEventSlot.size());
+            r.requiredCounts.emplace_back(it.first->second, x.second);
+        }
+    }
+    r.isActiveTP = c.isActiveTP;
+    r.tp = c.tp;
+    rules.push_back(r);
+    return rules.size() - 1;
+}
+
+// Check the rule for the person: the person attended all required events, 
+// the number of attended events of each required metaevent is in range, and 
+// the time profile (if any) is active
+bool ConstraintsLoader::checkRule(const SpacePersonRule& r, const Person& p, 
+        const DateTime& curr) const {
+    for (std::size_t w = 0; w < r.requiredBits.size(); ++w) {
+        std::uint64_t has = w < p.attendedBits.size() ? p.attendedBits[w] : 0;
+        if (r.requiredBits[w] & ~has)
+            return false;
+    }
+
+    for (const auto& x : r.requiredCounts) {
+        std::size_t m = x.first;
+        int count = m < p.attendedCounts.size() ? p.attendedCounts[m] : 0;
+        if ((x.second.first > count && x.second.first != -1) || 
+            (count > x.second.second && x.second.second != -1))
+            return false;
+    }
+
+    if (r.isActiveTP && !r.tp.active(curr))
+        return false;
+
+    return true;
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 // I/O
 
+// Write the constraints into the snapshot
+void ConstraintsLoader::save(SnapshotWriter& w) const {
+    w.put(cpcEntries, cmpcEntries, cecEntries, cmecEntries, pecEntries, 
+          pmecEntries, mpecEntries, mpmecEntries, cpcKeys, cmpcKeys, cecKeys, 
+          cmecKeys, pecKeys, pmecKeys, mpecKeys, mpmecKeys);
+}
+
+// Read the constraints from the snapshot
+void ConstraintsLoader::load(SnapshotReader& r) {
+    r.get(cpcEntries, cmpcEntries, cecEntries, cmecEntries, pecEntries, 
+          pmecEntries, mpecEntries, mpmecEntries, cpcKeys, cmpcKeys, cecKeys, 
+          cmecKeys, pecKeys, pmecKeys, mpecKeys, mpmecKeys);
+}
+
 // Print all constraints
 std::ostream& operator<<(std::ostream& oss, const ConstraintsLoader& csl) {
     oss << "Space-Person Constraints:" << std::endl;
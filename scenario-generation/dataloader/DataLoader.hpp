@@ -3,6 +3,9 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
+#include <functional>
+#include <atomic>
 
 #include "ConfigLoader.hpp"
 #include "SpacesLoader.hpp"
@@ -10,6 +13,7 @@
 #include "PeopleLoader.hpp"
 #include "SensorsLoader.hpp"
 #include "ConstraintsLoader.hpp"
+#include "ClosuresLoader.hpp"
 
 #include "MetaEventsLoader.hpp"
 #include "MetaPeopleLoader.hpp"
@@ -18,12 +22,69 @@
 
 #include "../utils/Typedefs.hpp"
 #include "../utils/DateUtils.hpp"
+#include "../utils/Graph.hpp"
+#include "../utils/ThreadPool.hpp"
+#include "../utils/Snapshot.hpp"
+
+namespace {
+
+// Read the (optional) spaces-graph section of the config file:
+//
+//   [spaces-graph]
+//   mode         = all-pairs (default), lazy or hierarchical
+//   lazy-cache   = MB of paths kept in lazy mode (default=64)
+//   cluster-size = size of the x/y cells of clusters in hierarchical mode 
+//                  (default=0, i.e., one cluster per floor)
+PathOptions readPathOptions(const ConfigLoader& config) {
+    PathOptions opts;
+    Value mode = config("spaces-graph", "mode", "all-pairs");
+    if (mode == "all-pairs")
+        opts.mode = PathMode::AllPairs;
+    else if (mode == "lazy")
+        opts.mode = PathMode::Lazy;
+    else if (mode == "hierarchical")
+        opts.mode = PathMode::Hierarchical;
+    else {
+        std::cerr << "DataLoader Error: unknown spaces-graph mode " 
+                  << mode << std::endl;
+        exitOnError();
+    }
+    opts.lazyBytes = 
+            std::stoul(config("spaces-graph", "lazy-cache", "64")) << 20;
+    opts.clusterSize = 
+            std::stod(config("spaces-graph", "cluster-size", "0"));
+    opts.alternatives = 
+            std::stoi(config("spaces-graph", "alternatives", "1"));
+    opts.stretch = 
+            std::stod(config("spaces-graph", "alternative-stretch", "1.5"));
+    return opts;
+}
+
+// Run the tasks concurrently, on a pool of threads. The output of each task is
+// written once it has finished. A task does not exit on an error (e.g., an 
+// invalid input file): the process exits once all tasks have finished.
+void runTasks(const std::vector<std::function<void()>>& tasks) {
+    std::atomic<bool> failed{false};
+    {
+        ThreadOutput out{std::cout}, err{std::cerr};
+        parallelFor(tasks.size(), [&](Index i) {
+            if (!catchExit(tasks[i]))
+                failed = true;
+            out.flush();
+            err.flush();
+        });
+    }
+    if (failed)
+        exitOnError();
+}
+
+} // end namespace
 
 class DataLoader {
 public:
 
     // Constructor
-    explicit DataLoader(const Filename& fname);
+    explicit DataLoader(const Filename& fname, bool loadEntities=false);
 
     // From entity generation
     void loadEvents();
@@ -36,6 +97,7 @@ public:
     TimePeriod query(const Event& e, const DateTime& dt);
 
     // I/O
+    void writeSnapshot();
     friend std::ostream& operator<<(std::ostream& oss, const DataLoader& dm);
 
     // Data loaders
@@ -47,6 +109,7 @@ public:
     SpacesLoader  C;
 
     ConstraintsLoader CS;
+    ClosuresLoader CL;
 
     MetaEventsLoader ME;
     MetaPeopleLoader MP;
@@ -55,31 +118,82 @@ public:
 
     Date start, end;
 
+private:
+
+    // Linking of the entities from entity generation
+    void linkEvents();
+    void linkPeople();
+
+    // Snapshot of the loaded scenario
+    bool loadSnapshot(bool loadEntities);
+    std::uint64_t inputsHash();
+    std::uint64_t entitiesHash();
+
 };
 
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 // Construtor
 
-// For the given config file, initialize all other data loaders except for 
-// events and people (use loadEvents(), loadPeople() instead)
-DataLoader::DataLoader(const Filename& fname)
+// For the given config file, initialize all other data loaders, and the 
+// events and people if loadEntities (else, use loadEvents(), loadPeople() 
+// after entity generation). The input files are independent, so they are 
+// read concurrently, unless they are read from the snapshot. The spaces and 
+// metatrajectories are read afterwards, on their own: finding the paths 
+// through the spaces uses all threads. The loaders are then linked together.
+DataLoader::DataLoader(const Filename& fname, bool loadEntities)
     : config{fname}, 
-      C{config("filepaths","spaces"), config("filepaths","spaces-cache","")},
-      S{config("filepaths","sensors")},
-      CS{config("filepaths","constraints", "none")},
-      MP{config("filepaths","metapeople")},
-      ME{config("filepaths","metaevents")},
-      MS{config("filepaths","metasensors")},
-      MT{config("filepaths","metatrajectories","none"), 
-         config("filepaths","path-cache","none"),
-         C},
       start{config("synthetic-data-generator","start")},
       end{config("synthetic-data-generator","end")}
 {
+    std::function<void()> paths = [this]() {
+        C = SpacesLoader{config("filepaths","spaces"), 
+                         config("filepaths","spaces-cache","")};
+        MT = MetaTrajectoriesLoader{
+                config("filepaths","metatrajectories","none"), 
+                config("filepaths","path-cache","none"),
+                C,
+                readPathOptions(config)};
+    };
+    std::vector<std::function<void()>> tasks{
+        [this]() { S = SensorsLoader{config("filepaths","sensors")}; },
+        [this]() { 
+            CS = ConstraintsLoader{config("filepaths","constraints","none")}; 
+        },
+        [this]() { 
+            CL = ClosuresLoader{config("filepaths","closures","none")}; 
+        },
+        [this]() { MP = MetaPeopleLoader{config("filepaths","metapeople")}; },
+        [this]() { ME = MetaEventsLoader{config("filepaths","metaevents")}; },
+        [this]() { MS = MetaSensorsLoader{config("filepaths","metasensors")}; }
+    };
+    if (loadEntities) {
+        tasks.push_back(
+                [this]() { E = EventsLoader{config("filepaths","events")}; });
+        tasks.push_back(
+                [this]() { P = PeopleLoader{config("filepaths","people")}; });
+    }
+    if (!loadSnapshot(loadEntities)) {
+        runTasks(tasks);
+        runTasks({paths});
+        if (loadEntities)
+            writeSnapshot();
+    }
+
+    // Time profiles are mostly queried for the simulated dates
+    timeProfiles().compile(start, end);
+
+    MT.setClosures(CL);
+
     CS.addSpaces(C);
     CS.addMetaEvents(ME);
     CS.addMetaPeople(MP);
+    CS.compile();
+
+    if (loadEntities) {
+        linkEvents();
+        linkPeople();
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -89,13 +203,98 @@ DataLoader::DataLoader(const Filename& fname)
 // Load events from the events file, after entity generation
 void DataLoader::loadEvents() { 
     E = EventsLoader{config("filepaths", "events")}; 
-    CS.addEvents(E);
+    linkEvents();
 }
 
 // Load people from the events file, after entity generation
 void DataLoader::loadPeople() { 
     P = PeopleLoader{config("filepaths", "people")}; 
-    CS.addPeople(P);
+    linkPeople();
+}
+
+// Link the events to the metapeople and constraints
+void DataLoader::linkEvents() {
+    E.compileCapacity(MP.getIDs());
+    CS.addEvents(E);
+}
+
+// Link the people to their metapeople
+void DataLoader::linkPeople() {
+    for (Person& p : P)
+        p.midx = MP.getIndex(p.mid);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// Snapshot
+
+// Return the hash of the input files (other than the events and people)
+std::uint64_t DataLoader::inputsHash() {
+    return hashFiles({config("filepaths","spaces"), 
+                      config("filepaths","sensors"), 
+                      config("filepaths","constraints","none"), 
+                      config("filepaths","closures","none"), 
+                      config("filepaths","metapeople"), 
+                      config("filepaths","metaevents"), 
+                      config("filepaths","metasensors"), 
+                      config("filepaths","metatrajectories","none")});
+}
+
+// Return the hash of the events and people files
+std::uint64_t DataLoader::entitiesHash() {
+    return hashFiles({config("filepaths","events"), 
+                      config("filepaths","people")});
+}
+
+// Read the loaders from the snapshot file (if any), and the events and people
+// if loadEntities. Return false if there is no snapshot, or if it is not of 
+// the current input files (then, the input files are read instead).
+bool DataLoader::loadSnapshot(bool loadEntities) {
+    Filename fname = config("filepaths","snapshot","none");
+    if (fname == "none")
+        return false;
+
+    SnapshotReader r{fname};
+    if (loadEntities ? !r.valid(inputsHash(), entitiesHash()) 
+                     : !r.valid(inputsHash()))
+        return false;
+
+    std::cout << "... Reading Snapshot file: " << fname << std::endl;
+
+    // The graph of the spaces (and its paths) are read from the path cache
+    timeProfiles().load(r);
+    r.get(C);
+    MT = MetaTrajectoriesLoader{C, 
+                                config("filepaths","path-cache","none"), 
+                                readPathOptions(config)};
+    r.get(MT, S, CS, CL, MP, ME, MS);
+    if (loadEntities)
+        r.get(E, P);
+    return true;
+}
+
+// Write the loaders, events and people into the snapshot file (if any), to be
+// read in place of the input files until they change
+void DataLoader::writeSnapshot() {
+    Filename fname = config("filepaths","snapshot","none");
+    if (fname == "none")
+        return;
+
+    std::cout << "... Writing Snapshot file: " << fname << std::endl;
+
+    SnapshotHeader h{};
+    std::memcpy(h.magic, snapshotMagic, sizeof h.magic);
+    h.version = snapshotVersion;
+    h.inputs = inputsHash();
+    h.entities = entitiesHash();
+
+    SnapshotWriter w{fname, h};
+    timeProfiles().save(w);
+    w.put(C, MT, S, CS, CL, MP, ME, MS, E, P);
+    if (!w.close()) {
+        std::cerr << "DataLoader Warning: cannot write snapshot file " 
+                  << fname << std::endl;
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -13,6 +13,7 @@
 
 #include "../utils/Typedefs.hpp"
 #include "../utils/IOUtils.hpp"
+#include "../utils/Snapshot.hpp"
 
 namespace {
 
@@ -31,15 +32,20 @@ public:
     // Queries
     int size() const;
     const EventIDList& getIDs() const;
+    Index getIndex(EventID id) const;
 
     EventID getLeisureEventID() const;
     EventID getOutEventID() const;
     Event& getLeisureEvent();
     Event& getOutEvent();
 
+    bool contains(EventID id) const;
     Event& operator[](EventID id);
     const Event& operator[](EventID id) const;
 
+    Event& getByIndex(Index eidx);
+    const IndexList& getCandidates(Index midx) const;
+
     // Iterators
     std::vector<Event>::iterator begin();
     std::vector<Event>::iterator end();
@@ -49,7 +55,12 @@ public:
     void addOutEvent();
     void addLeisureEvent();
 
+    void compileCapacity(const MetaPersonIDList& mids);
+    void enrollMetaPerson(Index eidx, Index midx);
+
     // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     void dump(const Filename& fname);
 
     friend std::ostream& operator<<(std::ostream& oss, const EventsLoader& el);
@@ -65,6 +76,10 @@ private:
     // A list of event ids
     EventIDList ids;
 
+    // For each metaperson (by dense index), the indices of the events that it
+    // still has capacity to attend, in the order of `entries`
+    std::vector<IndexList> candidates;
+
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -139,6 +154,9 @@ int EventsLoader::size() const { return entries.size(); }
 // Return a list of all the event ids 
 const EventIDList& EventsLoader::getIDs() const { return ids; }
 
+// Return the dense index of the event with the given id
+Index EventsLoader::getIndex(EventID id) const { return loc.at(id); }
+
 // Return the leisure event id
 EventID EventsLoader::getLeisureEventID() const { return 0; }
 
@@ -151,6 +169,10 @@ Event& EventsLoader::getLeisureEvent() { return (*this)[getLeisureEventID()]; }
 // Return a reference to the out-of-simulation event
 Event& EventsLoader::getOutEvent() { return (*this)[getOutEventID()]; }
 
+// Return whether there is a event with the given id
+bool EventsLoader::contains(EventID id) const 
+{ return loc.find(id) != loc.end(); }
+
 // Return a reference to the event with the given id
 Event& EventsLoader::operator[](EventID id) { return entries[loc[id]]; }
 
@@ -158,6 +180,14 @@ Event& EventsLoader::operator[](EventID id) { return entries[loc[id]]; }
 const Event& EventsLoader::operator[](EventID id) const 
 { return entries[loc.at(id)]; }
 
+// Return a reference to the event with the given dense index
+Event& EventsLoader::getByIndex(Index eidx) { return entries[eidx]; }
+
+// Return the indices of the events that the metaperson with the given dense
+// index can attend (requires compileCapacity())
+const IndexList& EventsLoader::getCandidates(Index midx) const 
+{ return candidates[midx]; }
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 // Iterators
@@ -210,6 +240,33 @@ void EventsLoader::addLeisureEvent() {
     }
 }
 
+// Compile the capacities of all events into dense arrays indexed by the 
+// positions of the metaperson ids in mids, and build the candidate events of
+// each metaperson
+void EventsLoader::compileCapacity(const MetaPersonIDList& mids) {
+    candidates.assign(mids.size(), IndexList{});
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        entries[i].compileCapacity(mids);
+        for (std::size_t m = 0; m < mids.size(); ++m)
+            if (entries[i].canAttend(m))
+                candidates[m].push_back(i);
+    }
+}
+
+// Records that the metaperson with dense index midx attends the event with 
+// dense index eidx. Once the event is full for the metaperson, it is removed 
+// from the candidates of the metaperson. (Previous events are attended again
+// regardless of capacity, so the event may already have been removed.)
+void EventsLoader::enrollMetaPerson(Index eidx, Index midx) {
+    entries[eidx].enrollMetaPerson(midx);
+    if (!entries[eidx].canAttend(midx)) {
+        IndexList& cl = candidates[midx];
+        IndexList::iterator it = std::find(cl.begin(), cl.end(), eidx);
+        if (it != cl.end())
+            cl.erase(it);
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 // I/O
@@ -224,6 +281,14 @@ void EventsLoader::dump(const Filename& fname) {
     dumpJSON(fname, doc);
 }
 
+// Write the events into the snapshot
+void EventsLoader::save(SnapshotWriter& w) const 
+{ w.put(loc, entries, ids); }
+
+// Read the events from the snapshot
+void EventsLoader::load(SnapshotReader& r) 
+{ r.get(loc, entries, ids); }
+
 // Print all events
 std::ostream& operator<<(std::ostream& oss, const EventsLoader& el) {
     oss << "Events:" << std::endl;
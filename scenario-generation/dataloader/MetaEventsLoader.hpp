@@ -12,6 +12,7 @@
 #include "../utils/Typedefs.hpp"
 #include "../utils/TimeProfile.hpp"
 #include "../utils/IOUtils.hpp"
+#include "../utils/Snapshot.hpp"
 
 namespace {
 
@@ -30,6 +31,7 @@ public:
     // Queries
     int size() const;
     const MetaEventIDList& getIDs() const;
+    Index getIndex(MetaEventID id) const;
     const ProbabilityList& getPrs() const;
 
     MetaEventID getOutMetaEventID() const;
@@ -48,6 +50,8 @@ public:
     void addLeisureMetaEvent();
 
     // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     friend std::ostream& operator<<(std::ostream& oss,
                                     const MetaEventsLoader& mel);
 
@@ -106,7 +110,7 @@ MetaEventsLoader::MetaEventsLoader(const Filename& fname) {
         me.tps.reserve(v["time-profiles"].Size());
         me.tpsPrs.reserve(v["time-profiles"].Size());
         for (const rj::Value& x : v["time-profiles"].GetArray()) {
-            me.tps.push_back(TimeProfile{x["profile"]});
+            me.tps.push_back(TimeProfileRef{x["profile"]});
             me.tpsPrs.push_back(parseDouble(x, "probability", 1.0));
         }
 
@@ -152,6 +156,9 @@ int MetaEventsLoader::size() const { return entries.size(); }
 // Return a list of all metaevent ids
 const MetaEventIDList& MetaEventsLoader::getIDs() const { return ids; }
 
+// Return the dense index of the metaevent with the given id
+Index MetaEventsLoader::getIndex(MetaEventID id) const { return loc.at(id); }
+
 // Return a list of all metaevent probabilities
 const ProbabilityList& MetaEventsLoader::getPrs() const { return prs; }
 
@@ -205,7 +212,7 @@ void MetaEventsLoader::addOutMetaEvent() {
         me.desc = "out-of-simulation (added)";
         me.pr = 1.0;
         me.selector = SpaceSelector{SpaceIDList{0}};
-        me.tps = TimeProfileList{TimeProfile{}};
+        me.tps = TimeProfileList{TimeProfileRef{}};
         me.tpsPrs = ProbabilityList{1};
         me.cap[-1] = std::make_pair(
                 Normal<int>{0,0},
@@ -226,7 +233,7 @@ void MetaEventsLoader::addLeisureMetaEvent() {
         me.desc = "leisure (added)";
         me.pr = 1.0;
         me.selector = SpaceSelector{SpaceIDList{0}};
-        me.tps = TimeProfileList{TimeProfile{}};
+        me.tps = TimeProfileList{TimeProfileRef{}};
         me.tpsPrs = ProbabilityList{1};
         me.cap[-1] = std::make_pair(
                 Normal<int>{0,0},
@@ -240,6 +247,14 @@ void MetaEventsLoader::addLeisureMetaEvent() {
 ////////////////////////////////////////////////////////////////////////////////
 // I/O
 
+// Write the metaevents into the snapshot
+void MetaEventsLoader::save(SnapshotWriter& w) const 
+{ w.put(loc, entries, ids, prs); }
+
+// Read the metaevents from the snapshot
+void MetaEventsLoader::load(SnapshotReader& r) 
+{ r.get(loc, entries, ids, prs); }
+
 // Print all metaevents
 std::ostream& operator<<(std::ostream& oss, const MetaEventsLoader& mel) {
     oss << "MetaEvents:" << std::endl;
@@ -13,6 +13,7 @@
 #include "../utils/Typedefs.hpp"
 #include "../utils/IOUtils.hpp"
 #include "../utils/TimeProfile.hpp"
+#include "../utils/Snapshot.hpp"
 
 class MetaPeopleLoader {
 public:
@@ -24,6 +25,7 @@ public:
     // Queries
     int size() const;
     const MetaPersonIDList& getIDs() const;
+    Index getIndex(MetaPersonID id) const;
     const ProbabilityList& getPrs() const;
 
     MetaPerson& operator[](MetaPersonID id);
@@ -37,6 +39,8 @@ public:
     void add(const MetaPerson& mp);
 
     // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     friend std::ostream& operator<<(std::ostream& oss, 
                                     const MetaPeopleLoader& mpl);
 
@@ -90,7 +94,7 @@ MetaPeopleLoader::MetaPeopleLoader(const Filename& fname) {
         mp.tps.reserve(v["time-profiles"].Size());
         mp.tpsPrs.reserve(v["time-profiles"].Size());
         for (const rj::Value& x : v["time-profiles"].GetArray()) {
-            mp.tps.push_back(TimeProfile{x["profile"]});
+            mp.tps.push_back(TimeProfileRef{x["profile"]});
             mp.tpsPrs.push_back(parseDouble(x, "probability"));
         }
 
@@ -113,6 +117,9 @@ int MetaPeopleLoader::size() const { return entries.size(); }
 // Return a list of all metaperson ids
 const MetaPersonIDList& MetaPeopleLoader::getIDs() const { return ids; }
 
+// Return the dense index of the metaperson with the given id
+Index MetaPeopleLoader::getIndex(MetaPersonID id) const { return loc.at(id); }
+
 // Return a list of all metaperson probabilities
 const ProbabilityList& MetaPeopleLoader::getPrs() const { return prs; }
 
@@ -152,6 +159,14 @@ void MetaPeopleLoader::add(const MetaPerson& mp) {
 ////////////////////////////////////////////////////////////////////////////////
 // I/O
 
+// Write the metapeople into the snapshot
+void MetaPeopleLoader::save(SnapshotWriter& w) const 
+{ w.put(loc, entries, ids, prs); }
+
+// Read the metapeople from the snapshot
+void MetaPeopleLoader::load(SnapshotReader& r) 
+{ r.get(loc, entries, ids, prs); }
+
 // Print all metapeople
 std::ostream& operator<<(std::ostream& oss, const MetaPeopleLoader& mpl) {
     oss << "MetaPeople:" << std::endl;
@@ -11,6 +11,7 @@
 
 #include "../utils/Typedefs.hpp"
 #include "../utils/IOUtils.hpp"
+#include "../utils/Snapshot.hpp"
 
 class MetaSensorsLoader {
 public:
@@ -34,6 +35,8 @@ public:
     void add(const MetaSensor& ms);
 
     // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     friend std::ostream& operator<<(std::ostream& oss, 
                                     const MetaSensorsLoader& ms);
 
@@ -129,6 +132,14 @@ void MetaSensorsLoader::add(const MetaSensor& ms) {
 ////////////////////////////////////////////////////////////////////////////////
 // I/O
 
+// Write the metasensors into the snapshot
+void MetaSensorsLoader::save(SnapshotWriter& w) const 
+{ w.put(loc, entries, ids); }
+
+// Read the metasensors from the snapshot
+void MetaSensorsLoader::load(SnapshotReader& r) 
+{ r.get(loc, entries, ids); }
+
 // Print all metasensors
 std::ostream& operator<<(std::ostream& oss, const MetaSensorsLoader& msl) { 
     oss << "MetaSensors:" << std::endl;
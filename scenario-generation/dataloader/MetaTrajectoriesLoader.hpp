@@ -3,9 +3,12 @@
 
 #include <iostream>
 #include <cstdlib>
+#include <cstdint>
 #include <random>
 #include <algorithm>
 #include <utility>
+#include <deque>
+#include <unordered_map>
 
 #include "../include/rapidjson/document.h"
 
@@ -14,6 +17,7 @@
 #include "../model/MetaTrajectory.hpp"
 
 #include "../dataloader/SpacesLoader.hpp"
+#include "../dataloader/ClosuresLoader.hpp"
 
 #include "../utils/Typedefs.hpp"
 #include "../utils/DateUtils.hpp"
@@ -21,6 +25,7 @@
 #include "../utils/Graph.hpp"
 #include "../utils/RandomGenerator.hpp"
 #include "../utils/NormalDistributions.hpp"
+#include "../utils/Snapshot.hpp"
 
 namespace {
     
@@ -30,6 +35,13 @@ namespace {
         static NormalTime n{"00:00:15", "00:00:05"};
         return n.sample();
     }
+
+    // Return the key of a src/dest in the trajectory tables: both space ids, 
+    // packed into 64 bits
+    std::uint64_t srcDestKey(SpaceID s, SpaceID t) {
+        return std::uint64_t{static_cast<std::uint32_t>(s)} << 32 | 
+               static_cast<std::uint32_t>(t);
+    }
     
 }
 
@@ -37,18 +49,28 @@ class MetaTrajectoriesLoader {
 public:
 
     MetaTrajectoriesLoader();
-    explicit MetaTrajectoriesLoader(SpacesLoader& cl, const Filename& cache);
+    MetaTrajectoriesLoader(
+            SpacesLoader& cl, 
+            const Filename& cache, 
+            const PathOptions& opts=PathOptions{});
     MetaTrajectoriesLoader(
             const Filename& fname, 
             const Filename& cache,
-            SpacesLoader& cl);
+            SpacesLoader& cl,
+            const PathOptions& opts=PathOptions{});
 
-    const Trajectory& getPath(
+    Trajectory getPath(
             SpaceID s, 
             SpaceID t, 
             bool useCache=false, 
             bool useShortest=false);
+    Trajectory getPath(SpaceID s, SpaceID t, const DateTime& dt);
 
+    void setClosures(const ClosuresLoader& cl);
+
+    // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     friend std::ostream& operator<<(
             std::ostream& oss, 
             const MetaTrajectoriesLoader& mt);
@@ -56,12 +78,31 @@ public:
 private:
 
     TimeList estTime(const SpaceIDList& sl) const;
-    int manhattan(const Coordinates& c1, const Coordinates& c2) const;
 
-    SrcDestIndexMap loc;
-    std::vector<MetaTrajectory> entries;
+    Trajectory sampleTimes(const SpaceIDList& sl) const;
+
+    const std::vector<SpaceIDList>& alternatives(
+            SpaceID s, 
+            SpaceID t, 
+            std::uint64_t key);
+    Index choose(std::uint64_t key, Index n, bool useCache) const;
+
+    // The metatrajectories read from the file (which do not move as more are 
+    // added), and the index of the metatrajectory of each src/dest
+    std::deque<MetaTrajectory> entries;
+    std::unordered_map<std::uint64_t, Index> loc;
+
+    // The routes found in the graph for each src/dest without a 
+    // metatrajectory, and the shortest path of each src/dest. Only the spaces 
+    // are kept: the hop times are sampled again on every request
+    std::unordered_map<std::uint64_t, std::vector<SpaceIDList>> routes;
+    std::unordered_map<std::uint64_t, SpaceIDList> shortest;
 
-    std::map<SrcDest, std::pair<Index, Index>> cache;
+    // The index of the trajectory (or route) last chosen for each src/dest
+    std::unordered_map<std::uint64_t, Index> cache;
+
+    // Shortest paths around closures, by src/dest and closure set
+    std::map<std::pair<SrcDest, Index>, SpaceIDList> detours;
 
     SpacesGraph g;
 
@@ -73,12 +114,16 @@ MetaTrajectoriesLoader::MetaTrajectoriesLoader() {}
 
 MetaTrajectoriesLoader::MetaTrajectoriesLoader(
         SpacesLoader& cl, 
-        const Filename& cache) 
-: g{cl,cache}, cl{cl} {}
+        const Filename& cache,
+        const PathOptions& opts) 
+: g{cl,cache,opts}, cl{cl} {}
 
 MetaTrajectoriesLoader::MetaTrajectoriesLoader(
-        const Filename& fname, const Filename& cache, SpacesLoader& cl) 
-: g{cl,cache}, cl{cl} {
+        const Filename& fname, 
+        const Filename& cache, 
+        SpacesLoader& cl,
+        const PathOptions& opts) 
+: g{cl,cache,opts}, cl{cl} {
     if (fname == "none")
         return;
 
@@ -86,7 +131,7 @@ MetaTrajectoriesLoader::MetaTrajectoriesLoader(
 
     rapidjson::Document doc;
     openJSON(fname, doc);
-    entries.reserve(doc.Size());
+    loc.reserve(doc.Size());
 
     for (const rapidjson::Value& v : doc.GetArray()) {
         MetaTrajectory e;
@@ -98,9 +143,10 @@ MetaTrajectoriesLoader::MetaTrajectoriesLoader(
         for (const rapidjson::Value& x : v["Delta"].GetArray())
             te.delta.push_back(Time(x.GetString()));
 
-        auto it = loc.find(e.sd);
+        std::uint64_t key = srcDestKey(e.sd.first, e.sd.second);
+        auto it = loc.find(key);
         if (it == loc.end()) {
-            loc[e.sd] = entries.size();
+            loc[key] = entries.size();
             e.trajs.push_back(te);
             entries.push_back(e);
         }
@@ -110,41 +156,85 @@ MetaTrajectoriesLoader::MetaTrajectoriesLoader(
     }
 }
 
-const Trajectory& MetaTrajectoriesLoader::getPath(
+// Return a path between s and t. The trajectories read from the file are 
+// returned as is; the routes found in the graph get newly sampled hop times.
+Trajectory MetaTrajectoriesLoader::getPath(
         SpaceID s, 
         SpaceID t, 
         bool useCache, 
         bool useShortest) {
-    SrcDest sd{s,t};
-    auto eit = loc.find(sd);
-    // if no path exists or useShortest, then use shortest path
-    if (useShortest || eit == loc.end()) { 
-        MetaTrajectory e;
-        e.sd = sd;
-        loc[e.sd] = entries.size();
-        const SpaceIDList& sl = g.shortestPath(s,t);
-        TimeList tl = estTime(sl);
-        e.trajs.push_back(Trajectory{sl,tl});
-        entries.push_back(e);
-        return entries[entries.size()-1].trajs[0];
+    std::uint64_t key = srcDestKey(s,t);
+
+    // if useShortest, then use the shortest path (found once)
+    if (useShortest) {
+        auto it = shortest.find(key);
+        if (it == shortest.end())
+            it = shortest.emplace(key, g.shortestPath(s,t)).first;
+        return sampleTimes(it->second);
     }
 
-    if (useCache) {
-        auto it = cache.find(sd);
-        if (it != cache.end()) { 
-            const MetaTrajectory& e = entries[it->second.first];
-            return e.trajs[it->second.second];
-        }
+    // if no path exists, then use the shortest path (or sample among the 
+    // alternative routes, if any), found once
+    auto eit = loc.find(key);
+    if (eit == loc.end()) { 
+        const std::vector<SpaceIDList>& rl = alternatives(s, t, key);
+        Index routeIdx = choose(key, rl.size(), useCache);
+        cache[key] = routeIdx;
+        return sampleTimes(rl[routeIdx]);
     }
 
-    Index entryIdx = loc[sd];
-    const MetaTrajectory& e = entries[entryIdx];
-    Index trajIdx = randInt(e.trajs.size()-1);
-
-    cache[sd] = std::make_pair(entryIdx, trajIdx);
+    const MetaTrajectory& e = entries[eit->second];
+    Index trajIdx = choose(key, e.trajs.size(), useCache);
+    cache[key] = trajIdx;
     return e.trajs[trajIdx];
 }
 
+// Return a path between s and t at datetime dt. If the path that would be 
+// chosen uses a space or passage closed at dt, the shortest path around the 
+// closures is used instead (and the choice of path is not kept).
+Trajectory MetaTrajectoriesLoader::getPath(
+        SpaceID s, 
+        SpaceID t, 
+        const DateTime& dt) {
+    Index set = g.closuresAt(dt);
+    if (set == -1)
+        return getPath(s, t);
+
+    std::uint64_t key = srcDestKey(s,t);
+    const Trajectory* te = nullptr;
+    const SpaceIDList* sl;
+    Index idx;
+    auto eit = loc.find(key);
+    if (eit == loc.end()) {
+        const std::vector<SpaceIDList>& rl = alternatives(s, t, key);
+        idx = choose(key, rl.size(), false);
+        sl = &rl[idx];
+    }
+    else {
+        const MetaTrajectory& e = entries[eit->second];
+        idx = choose(key, e.trajs.size(), false);
+        te = &e.trajs[idx];
+        sl = &te->traj;
+    }
+
+    if (g.isOpen(*sl, set)) {
+        cache[key] = idx;
+        return te ? *te : sampleTimes(*sl);
+    }
+
+    std::pair<SrcDest, Index> dkey{SrcDest{s,t}, set};
+    auto it = detours.find(dkey);
+    if (it == detours.end())
+        it = detours.emplace(dkey, g.shortestPath(s, t, dt)).first;
+    return sampleTimes(it->second);
+}
+
+// Set the closures of spaces and passages
+void MetaTrajectoriesLoader::setClosures(const ClosuresLoader& cl) {
+    g.setClosures(cl.getClosures());
+    detours.clear();
+}
+
 TimeList MetaTrajectoriesLoader::estTime(const SpaceIDList& sl) const {
     /*
     TimeList tl(sl.empty() ? 0 : sl.size()-1);
@@ -154,20 +244,51 @@ TimeList MetaTrajectoriesLoader::estTime(const SpaceIDList& sl) const {
     return tl;
     */
 
-    TimeList tl;
-    for (int i = 0; i < sl.size()-1; ++i) {
-        int d = manhattan(cl[sl[i]].coords, cl[sl[i+1]].coords);
-        tl.push_back(NormalTime{Time{d*5}, Time{d*1}}.sample());
-    }
-    return tl;
+    // Each hop takes N(5d, d) seconds, for the distance d between spaces, 
+    // as precomputed for each edge of the graph
+    return g.travelTimes(sl);
 }
 
-int MetaTrajectoriesLoader::manhattan(
-        const Coordinates& c1, 
-        const Coordinates& c2) const {
-    return abs(c1[0]-c2[0]) + abs(c1[1]-c2[1]) + abs(c1[2]-c2[2]);
+// Return the route sl with newly sampled hop times
+Trajectory MetaTrajectoriesLoader::sampleTimes(const SpaceIDList& sl) const 
+{ return Trajectory{sl, estTime(sl)}; }
+
+// Return the routes found in the graph between s and t (with the given key), 
+// found once
+const std::vector<SpaceIDList>& MetaTrajectoriesLoader::alternatives(
+        SpaceID s, 
+        SpaceID t, 
+        std::uint64_t key) {
+    auto it = routes.find(key);
+    if (it == routes.end())
+        it = routes.emplace(key, g.alternativePaths(s,t)).first;
+    return it->second;
 }
 
+// Return the index of one of the n trajectories of the src/dest with the 
+// given key: the one last chosen if useCache, or else a random one
+Index MetaTrajectoriesLoader::choose(
+        std::uint64_t key, 
+        Index n, 
+        bool useCache) const {
+    if (useCache) {
+        auto it = cache.find(key);
+        if (it != cache.end())
+            return it->second;
+    }
+    return randInt(n-1);
+}
+
+// Write the metatrajectories read from the file into the snapshot (the paths 
+// found in the graph are kept in its own path cache)
+void MetaTrajectoriesLoader::save(SnapshotWriter& w) const 
+{ w.put(entries, loc); }
+
+// Read the metatrajectories from the snapshot
+void MetaTrajectoriesLoader::load(SnapshotReader& r) 
+{ r.get(entries, loc); }
+
+// Print all metatrajectories
 std::ostream& operator<<(std::ostream& oss, const MetaTrajectoriesLoader& mt) {
     oss << "MetaTrajectories:" << std::endl;
     for (const MetaTrajectory& e : mt.entries) {
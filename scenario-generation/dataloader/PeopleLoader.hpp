@@ -10,6 +10,7 @@
 #include "../model/Person.hpp"
 
 #include "../utils/Typedefs.hpp"
+#include "../utils/Snapshot.hpp"
 
 class PeopleLoader {
 public:
@@ -22,6 +23,7 @@ public:
     int size() const;
     const PersonIDList& getIDs() const;
 
+    bool contains(PersonID id) const;
     Person& operator[](PersonID id);
     const Person& operator[](PersonID id) const;
 
@@ -33,6 +35,8 @@ public:
     void add(const Person& p);
 
     // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     void dump(const Filename& fname);
 
     friend std::ostream& operator<<(std::ostream& oss, const PeopleLoader& pl);
@@ -98,6 +102,10 @@ int PeopleLoader::size() const { return entries.size(); }
 // Return a list fo all the person ids
 const PersonIDList& PeopleLoader::getIDs() const { return ids; }
 
+// Return whether there is a person with the given id
+bool PeopleLoader::contains(PersonID id) const 
+{ return loc.find(id) != loc.end(); }
+
 // Return a reference to the person with the given id
 Person& PeopleLoader::operator[](PersonID id) { return entries[loc[id]]; }
 
@@ -141,6 +149,14 @@ void PeopleLoader::dump(const Filename& fname) {
 }
 
 
+// Write the people into the snapshot
+void PeopleLoader::save(SnapshotWriter& w) const 
+{ w.put(loc, entries, ids); }
+
+// Read the people from the snapshot
+void PeopleLoader::load(SnapshotReader& r) 
+{ r.get(loc, entries, ids); }
+
 // Print all people
 std::ostream& operator<<(std::ostream& oss, const PeopleLoader& pl) {
     oss << "People:" << std::endl;
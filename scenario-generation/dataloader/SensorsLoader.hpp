@@ -11,6 +11,7 @@
 
 #include "../utils/Typedefs.hpp"
 #include "../utils/IOUtils.hpp"
+#include "../utils/Snapshot.hpp"
 
 class SensorsLoader {
 public:
@@ -35,6 +36,8 @@ public:
     void add(const Sensor& s);
 
     // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     friend std::ostream& operator<<(std::ostream& oss, const SensorsLoader& sl);
 
 private:
@@ -141,6 +144,14 @@ void SensorsLoader::add(const Sensor& s) {
 ////////////////////////////////////////////////////////////////////////////////
 // I/O
 
+// Write the sensors into the snapshot
+void SensorsLoader::save(SnapshotWriter& w) const 
+{ w.put(loc, entries, ids, idsByMetaSensorID); }
+
+// Read the sensors from the snapshot
+void SensorsLoader::load(SnapshotReader& r) 
+{ r.get(loc, entries, ids, idsByMetaSensorID); }
+
 // Print all sensors
 std::ostream& operator<<(std::ostream& oss, const SensorsLoader& sl) {
     oss << "Sensors:" << std::endl;
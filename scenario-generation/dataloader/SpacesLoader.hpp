@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 #include <cmath>
+#include <limits>
 
 #include "../include/rapidjson/document.h"
 
@@ -12,6 +13,8 @@
 
 #include "../utils/Typedefs.hpp"
 #include "../utils/IOUtils.hpp"
+#include "../utils/Distances.hpp"
+#include "../utils/Snapshot.hpp"
 
 class SpacesLoader {
 public:
@@ -23,12 +26,15 @@ public:
     // Queries
     int size() const;
     const SpaceIDList& getIDs() const;
+    Index getIndex(SpaceID id) const;
 
     double dist(SpaceID cid1, SpaceID cid2) const;
+    PointsView getPoints() const;
 
     SpaceID getOutsideSpaceID() const;
     Space& getOutsideSpace();
 
+    bool contains(SpaceID id) const;
     Space& operator[](SpaceID id);
     const Space& operator[](SpaceID id) const;
 
@@ -40,6 +46,8 @@ public:
     void add(const Space& c);
 
     // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     friend std::ostream& operator<<(std::ostream& oss, const SpacesLoader& sl);
 
 private:
@@ -53,6 +61,12 @@ private:
     // A list of space ids
     SpaceIDList ids;
 
+    // The coordinates of each space (by index in `entries`), as structure of 
+    // arrays; NaN for spaces without coordinates
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> z;
+
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -70,6 +84,9 @@ SpacesLoader::SpacesLoader(const Filename& fname, const Filename& cache) {
     rj::Document doc;
     openJSON(fname, doc);
     entries.reserve(doc.Size());
+    x.reserve(doc.Size());
+    y.reserve(doc.Size());
+    z.reserve(doc.Size());
 
     for (const rj::Value& v : doc.GetArray()) {
 
@@ -91,6 +108,9 @@ SpacesLoader::SpacesLoader(const Filename& fname, const Filename& cache) {
         // neighbors
         c.neighbors = parseIntArr(v, "neighbors");
 
+        // cluster (for hierarchical paths)
+        c.cluster = parseInt(v, "cluster", -1);
+
         // Add the space to the data loader
         add(c);
     }
@@ -107,21 +127,29 @@ int SpacesLoader::size() const { return entries.size(); }
 // Return a list of all the space ids
 const SpaceIDList& SpacesLoader::getIDs() const { return ids; }
 
+// Return the dense index of the space with the given id
+Index SpacesLoader::getIndex(SpaceID id) const { return loc.at(id); }
+
 // Return the manhattan distance between the two ids
 double SpacesLoader::dist(SpaceID cid1, SpaceID cid2) const {
-    Coordinates coords1 = (*this)[cid1].coords;
-    Coordinates coords2 = (*this)[cid2].coords;
-    return fabs(coords1[0] - coords2[0]) + 
-           fabs(coords1[1] - coords2[1]) + 
-           fabs(coords1[2] - coords2[2]);
+    Index i = loc.at(cid1), j = loc.at(cid2);
+    return fabs(x[i] - x[j]) + fabs(y[i] - y[j]) + fabs(z[i] - z[j]);
 }
 
+// Return a view of the coordinates of the spaces (by dense index)
+PointsView SpacesLoader::getPoints() const 
+{ return PointsView{x.data(), y.data(), z.data(), x.size()}; }
+
 // Return the outside space id
 SpaceID SpacesLoader::getOutsideSpaceID() const { return 0; }
 
 // Return a reference to the outside space
 Space& SpacesLoader::getOutsideSpace() { return (*this)[getOutsideSpaceID()]; }
 
+// Return whether there is a space with the given id
+bool SpacesLoader::contains(SpaceID id) const 
+{ return loc.find(id) != loc.end(); }
+
 // Return a reference to the space with the given id
 Space& SpacesLoader::operator[](SpaceID id) { return entries[loc[id]]; }
 
@@ -148,12 +176,25 @@ void SpacesLoader::add(const Space& c) {
     ids.push_back(c.id);
     loc[c.id] = entries.size();
     entries.push_back(c);
+
+    bool has = c.coords.size() >= 3;
+    x.push_back(has ? c.coords[0] : std::numeric_limits<double>::quiet_NaN());
+    y.push_back(has ? c.coords[1] : std::numeric_limits<double>::quiet_NaN());
+    z.push_back(has ? c.coords[2] : std::numeric_limits<double>::quiet_NaN());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 // I/O
 
+// Write the spaces into the snapshot
+void SpacesLoader::save(SnapshotWriter& w) const 
+{ w.put(loc, entries, ids, x, y, z); }
+
+// Read the spaces from the snapshot
+void SpacesLoader::load(SnapshotReader& r) 
+{ r.get(loc, entries, ids, x, y, z); }
+
 // Print all spaces
 std::ostream& operator<<(std::ostream& oss, const SpacesLoader& sl) {
     oss << "Spaces:" << std::endl;
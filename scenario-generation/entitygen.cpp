@@ -37,5 +37,13 @@ int main(int argc, char* argv[]) {
             dl.config("filepaths","people")
     );
 
+    // Write the snapshot of the scenario with the generated entities, if 
+    // desired, so that the synthetic data generation need not read the files
+    if (dl.config("filepaths","snapshot","none") != "none") {
+        dl.loadEvents();
+        dl.loadPeople();
+        dl.writeSnapshot();
+    }
+
     return 0;
 }
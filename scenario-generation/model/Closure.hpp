@@ -0,0 +1,38 @@
+#ifndef MODEL_CLOSURE_HPP
+#define MODEL_CLOSURE_HPP
+
+#include <iostream>
+
+#include "../utils/Typedefs.hpp"
+#include "../utils/DateUtils.hpp"
+
+// A space, or the passage between a space and its neighbor (in both 
+// directions), that is closed between the start and end datetimes
+class Closure {
+public:
+
+    // Attributes
+    SpaceID sid;
+    SpaceID nid; // -1 if the whole space is closed
+    DateTime start, end;
+
+    // I/O
+    friend std::ostream& operator<<(std::ostream& oss, const Closure& c);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// I/O
+
+// Print a closure
+std::ostream& operator<<(std::ostream& oss, const Closure& c) {
+    oss << "Closure("
+        << "sid=" << c.sid << ", "
+        << "nid=" << c.nid << ", "
+        << "start=" << c.start << ", "
+        << "end=" << c.end
+        << ")";
+    return oss;
+}
+
+#endif // MODEL_CLOSURE_HPP
@@ -9,6 +9,7 @@
 
 #include "../utils/Typedefs.hpp"
 #include "../utils/IOUtils.hpp"
+#include "../utils/Snapshot.hpp"
 
 class Event {
 public:
@@ -22,21 +23,28 @@ public:
     PersonCapRange cap;
 
     // Queries
-    bool canAttend(MetaPersonID mid);
+    bool isUnlimited() const;
+    bool canAttend(Index midx) const;
     int totalCapacity() const;
 
     // Modifiers
-    void enrollMetaPerson(MetaPersonID mid);
+    void compileCapacity(const MetaPersonIDList& mids);
+    void enrollMetaPerson(Index midx);
 
     // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     rj::Value dump(rj::Document::AllocatorType& alloc) const;
 
     friend std::ostream& operator<<(std::ostream& oss, const Event& e);
 
 private:
     
-    // Synthetic Data Generation
-    std::map<MetaPersonID, CapRange> enrolled;
+    // Synthetic Data Generation; capacities are compiled into dense arrays
+    // indexed by the dense metaperson index (see compileCapacity())
+    bool unlimited = false;
+    std::vector<int> maxCap;
+    std::vector<int> enrolled;
 
 };
 
@@ -44,14 +52,14 @@ private:
 ////////////////////////////////////////////////////////////////////////////////
 // Queries
 
-// Returns whether there is enough capacity for the given metaperson to attend
-bool Event::canAttend(MetaPersonID mid) {
-    std::map<MetaPersonID, CapRange>::const_iterator eit = enrolled.find(mid);
-    PersonCapRange::const_iterator rit = cap.find(mid);
-    if (eit == enrolled.end()) // mid not found (no attendance yet)
-        return rit == cap.end() ? false : rit->second.second != 0;
+// Returns whether the event has unlimited capacity (e.g., the leisure event)
+bool Event::isUnlimited() const { return unlimited; }
 
-    return eit->second.second <= rit->second.second;
+// Returns whether there is enough capacity for the metaperson with the given
+// dense index to attend. A metaperson without a capacity cannot attend.
+bool Event::canAttend(Index midx) const {
+    return unlimited || 
+           (maxCap[midx] > 0 && enrolled[midx] <= maxCap[midx]);
 }
 
 // Returns the total maximum capacity of the event
@@ -66,8 +74,21 @@ int Event::totalCapacity() const {
 ////////////////////////////////////////////////////////////////////////////////
 // Modifiers
 
-// Records that a given metaperson attends this event
-void Event::enrollMetaPerson(MetaPersonID mid) { enrolled[mid].second += 1; }
+// Compile the capacity ranges into dense arrays, indexed by the positions of
+// the metaperson ids in mids
+void Event::compileCapacity(const MetaPersonIDList& mids) {
+    unlimited = cap.find(-1) != cap.end();
+    maxCap.assign(mids.size(), -1);
+    enrolled.assign(mids.size(), 0);
+    for (std::size_t i = 0; i < mids.size(); ++i) {
+        PersonCapRange::const_iterator it = cap.find(mids[i]);
+        if (it != cap.end())
+            maxCap[i] = it->second.second;
+    }
+}
+
+// Records that the metaperson with the given dense index attends this event
+void Event::enrollMetaPerson(Index midx) { enrolled[midx] += 1; }
 
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
@@ -109,6 +130,14 @@ rj::Value Event::dump(rj::Document::AllocatorType& alloc) const {
     return v;
 }
 
+// Write the event into the snapshot
+void Event::save(SnapshotWriter& w) const 
+{ w.put(id, mid, desc, tp, spaces, cap); }
+
+// Read the event from the snapshot
+void Event::load(SnapshotReader& r) 
+{ r.get(id, mid, desc, tp, spaces, cap); }
+
 // Print an event
 std::ostream& operator<<(std::ostream& oss, const Event& e) {
     oss << "Event("
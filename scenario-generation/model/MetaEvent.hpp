@@ -7,6 +7,7 @@
 #include "../utils/IOUtils.hpp"
 #include "../utils/TimeProfile.hpp"
 #include "../utils/Selectors.hpp"
+#include "../utils/Snapshot.hpp"
 
 class MetaEvent {
 public: 
@@ -21,6 +22,8 @@ public:
     PersonCapRangeDistr cap;
 
     // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     friend std::ostream& operator<<(std::ostream& oss, const MetaEvent& me);
 };
 
@@ -28,6 +31,14 @@ public:
 ////////////////////////////////////////////////////////////////////////////////
 // I/O
 
+// Write the metaevent into the snapshot
+void MetaEvent::save(SnapshotWriter& w) const 
+{ w.put(id, desc, pr, selector, tps, tpsPrs, cap); }
+
+// Read the metaevent from the snapshot
+void MetaEvent::load(SnapshotReader& r) 
+{ r.get(id, desc, pr, selector, tps, tpsPrs, cap); }
+
 // Print a metaevent
 std::ostream& operator<<(std::ostream& oss, const MetaEvent& me) {
     oss << "MetaEvent("
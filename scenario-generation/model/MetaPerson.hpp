@@ -6,6 +6,7 @@
 #include "../utils/Typedefs.hpp"
 #include "../utils/IOUtils.hpp"
 #include "../utils/TimeProfile.hpp"
+#include "../utils/Snapshot.hpp"
 
 class MetaPerson {
 public:
@@ -19,6 +20,8 @@ public:
     EventAffinity aff;
 
     // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     friend std::ostream& operator<<(std::ostream& oss, const MetaPerson& mp);
 };
 
@@ -26,6 +29,14 @@ public:
 ////////////////////////////////////////////////////////////////////////////////
 // I/O
 
+// Write the metaperson into the snapshot
+void MetaPerson::save(SnapshotWriter& w) const 
+{ w.put(id, pr, desc, tps, tpsPrs, aff); }
+
+// Read the metaperson from the snapshot
+void MetaPerson::load(SnapshotReader& r) 
+{ r.get(id, pr, desc, tps, tpsPrs, aff); }
+
 // Print a metaperson
 std::ostream& operator<<(std::ostream& oss, const MetaPerson& mp) {
     oss << "MetaPerson("
@@ -5,6 +5,7 @@
 
 #include "../utils/Typedefs.hpp"
 #include "../utils/IOUtils.hpp"
+#include "../utils/Snapshot.hpp"
 
 class MetaSensor {
 public:
@@ -17,6 +18,8 @@ public:
     SensorIDList sids;
 
     // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     friend std::ostream& operator<<(std::ostream& oss, const MetaSensor& ms);
 };
 
@@ -24,6 +27,14 @@ public:
 ////////////////////////////////////////////////////////////////////////////////
 // I/O
 
+// Write the metasensor into the snapshot
+void MetaSensor::save(SnapshotWriter& w) const 
+{ w.put(id, desc, sids); }
+
+// Read the metasensor from the snapshot
+void MetaSensor::load(SnapshotReader& r) 
+{ r.get(id, desc, sids); }
+
 // Print a metasensor
 std::ostream& operator<<(std::ostream& oss, const MetaSensor& ms) {
     oss << "MetaSensor(" 
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "../utils/Typedefs.hpp"
+#include "../utils/Snapshot.hpp"
 
 #include "Trajectory.hpp"
 
@@ -16,6 +17,8 @@ public:
     std::vector<Trajectory> trajs;
 
     // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     friend std::ostream& operator<<(std::ostream& oss, 
                                     const MetaTrajectory& mt);
 
@@ -25,6 +28,14 @@ public:
 ////////////////////////////////////////////////////////////////////////////////
 // I/O
 
+// Write the metatrajectory into the snapshot
+void MetaTrajectory::save(SnapshotWriter& w) const 
+{ w.put(sd, trajs); }
+
+// Read the metatrajectory from the snapshot
+void MetaTrajectory::load(SnapshotReader& r) 
+{ r.get(sd, trajs); }
+
 // Print a metatrajectory
 std::ostream& operator<<(std::ostream& oss, const MetaTrajectory& mt) {
     oss << "MetaTrajectory("
@@ -4,11 +4,14 @@
 #include <iostream>
 #include <map>
 #include <set>
+#include <vector>
+#include <cstdint>
 
 #include "../include/rapidjson/document.h"
 
 #include "../utils/Typedefs.hpp"
 #include "../utils/EventLogistics.hpp"
+#include "../utils/Snapshot.hpp"
 
 class Person {
 public:
@@ -19,6 +22,9 @@ public:
     Description desc;
     Index tp;
 
+    // Dense index of the metaperson (set when loaded for data generation)
+    Index midx;
+
     // Queries
     SpaceID getCurrentSpace() const;
     const std::set<EventLogistics>& getAttendedEvents() const;
@@ -28,6 +34,8 @@ public:
     void addAttendedEvent(EventLogistics el);
 
     // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     rj::Value dump(rj::Document::AllocatorType& alloc) const;
 
     friend std::ostream& operator<<(std::ostream& oss, const Person& p);
@@ -36,9 +44,11 @@ public:
     SpaceID currSpace;
     std::set<EventLogistics> attended;
 
-    // Constraints
-    std::set<EventID> attendedEventIDs;
-    std::map<MetaEventID, int> attendedMetaEventIDs;
+    // Constraints: the attended events required by constraints (as bits), 
+    // and the number of attended events of each metaevent required by 
+    // constraints, by the slots of ConstraintsLoader (see addAttendance)
+    std::vector<std::uint64_t> attendedBits;
+    std::vector<int> attendedCounts;
 
 };
 
@@ -63,8 +73,6 @@ void Person::setCurrentSpace(SpaceID cid) { currSpace = cid; }
 // Adds the given attended event to this person's list of attended events
 void Person::addAttendedEvent(EventLogistics el) { 
     attended.insert(el); 
-    attendedEventIDs.insert(el.eid);
-    attendedMetaEventIDs[el.meid] += 1;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -82,6 +90,14 @@ rj::Value Person::dump(rj::Document::AllocatorType& alloc) const {
     return v;
 }
 
+// Write the person into the snapshot
+void Person::save(SnapshotWriter& w) const 
+{ w.put(id, mid, desc, tp); }
+
+// Read the person from the snapshot
+void Person::load(SnapshotReader& r) 
+{ r.get(id, mid, desc, tp); }
+
 // Print a person
 std::ostream& operator<<(std::ostream& oss, const Person& p) {
     oss << "Person("
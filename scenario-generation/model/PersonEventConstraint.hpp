@@ -6,6 +6,7 @@
 #include "../utils/Typedefs.hpp"
 #include "../utils/IOUtils.hpp"
 #include "../utils/TimeProfile.hpp"
+#include "../utils/Snapshot.hpp"
 
 class PersonEventConstraint {
 public:
@@ -34,6 +35,8 @@ public:
     void setRange(CapRange range);
 
     // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     friend std::ostream& operator<<(std::ostream& oss, 
                                     const SpacePersonConstraint& cpc);
 };
@@ -82,6 +85,18 @@ void PersonEventConstraint::setRange(CapRange range) {
 ////////////////////////////////////////////////////////////////////////////////
 // I/O
 
+// Write the constraint into the snapshot
+void PersonEventConstraint::save(SnapshotWriter& w) const {
+    w.put(whichPerson, pid, mpid, whichEvent, eid, meid, isActiveCountdown, 
+          countdown, isActiveCapRange, range);
+}
+
+// Read the constraint from the snapshot
+void PersonEventConstraint::load(SnapshotReader& r) {
+    r.get(whichPerson, pid, mpid, whichEvent, eid, meid, isActiveCountdown, 
+          countdown, isActiveCapRange, range);
+}
+
 // Print a person-event constraint
 std::ostream& operator<<(std::ostream& oss, const PersonEventConstraint& pec) {
     oss << "PersonEventConstraint(";
@@ -5,6 +5,7 @@
 
 #include "../utils/Typedefs.hpp"
 #include "../utils/IOUtils.hpp"
+#include "../utils/Snapshot.hpp"
 
 class Sensor {
 public:
@@ -17,6 +18,8 @@ public:
     Coverage cov;
 
     // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     friend std::ostream& operator<<(std::ostream& oss, const Sensor& s);
 };
 
@@ -24,6 +27,14 @@ public:
 ////////////////////////////////////////////////////////////////////////////////
 // I/O
 
+// Write the sensor into the snapshot
+void Sensor::save(SnapshotWriter& w) const 
+{ w.put(id, mid, desc, coords, cov); }
+
+// Read the sensor from the snapshot
+void Sensor::load(SnapshotReader& r) 
+{ r.get(id, mid, desc, coords, cov); }
+
 // Print a sensor
 std::ostream& operator<<(std::ostream& oss, const Sensor& s) {
     oss << "Sensor("
@@ -9,6 +9,7 @@
 #include "../utils/Typedefs.hpp"
 #include "../utils/DateUtils.hpp"
 #include "../utils/IOUtils.hpp"
+#include "../utils/Snapshot.hpp"
 
 class Space {
 public:
@@ -19,6 +20,7 @@ public:
     Coordinates coords;
     MaxCap cap;
     SpaceIDList neighbors;
+    ClusterID cluster;
 
     // Queries
     int getOccupancy(const DateTime& dt) const;
@@ -28,6 +30,8 @@ public:
     void insertOccupancy(const DateTime& s, const DateTime& e);
 
     // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     friend std::ostream& operator<<(std::ostream& oss, const Space& c);
 
 private:
@@ -75,6 +79,14 @@ void Space::insertOccupancy(const DateTime& s, const DateTime& e) {
 ////////////////////////////////////////////////////////////////////////////////
 // I/O
 
+// Write the space into the snapshot
+void Space::save(SnapshotWriter& w) const 
+{ w.put(id, desc, coords, cap, neighbors, cluster); }
+
+// Read the space from the snapshot
+void Space::load(SnapshotReader& r) 
+{ r.get(id, desc, coords, cap, neighbors, cluster); }
+
 // Print a space
 std::ostream& operator<<(std::ostream& oss, const Space& c) {
     oss << "Space("
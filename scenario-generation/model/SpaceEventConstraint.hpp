@@ -6,6 +6,7 @@
 #include "../utils/Typedefs.hpp"
 #include "../utils/IOUtils.hpp"
 #include "../utils/TimeProfile.hpp"
+#include "../utils/Snapshot.hpp"
 
 class SpaceEventConstraint {
 public:
@@ -18,7 +19,7 @@ public:
     SpaceID cid;
 
     bool isActiveTP = false; // true = active TP, false = inactive TP
-    TimeProfile tp;
+    TimeProfileRef tp;
 
     bool isActiveCapacity = false; // true = active cap, false = inactive cap
     CapRange cap;
@@ -26,10 +27,12 @@ public:
     // Modifiers
     void setEventID(EventID eid);
     void setMetaEventID(MetaEventID meid);
-    void setTimeProfile(TimeProfile tp);
+    void setTimeProfile(TimeProfileRef tp);
     void setCapacity(CapRange cap);
 
     // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     friend std::ostream& operator<<(std::ostream& oss, 
                                     const SpaceEventConstraint& cec);
 };
@@ -51,7 +54,7 @@ void SpaceEventConstraint::setMetaEventID(MetaEventID meid) {
 }
 
 // Set the time profile (and flag)
-void SpaceEventConstraint::setTimeProfile(TimeProfile tp) {
+void SpaceEventConstraint::setTimeProfile(TimeProfileRef tp) {
     isActiveTP = true;
     this->tp = tp;
 }
@@ -66,6 +69,14 @@ void SpaceEventConstraint::setCapacity(CapRange cap) {
 ////////////////////////////////////////////////////////////////////////////////
 // I/O
 
+// Write the constraint into the snapshot
+void SpaceEventConstraint::save(SnapshotWriter& w) const 
+{ w.put(whichEvent, eid, meid, cid, isActiveTP, tp, isActiveCapacity, cap); }
+
+// Read the constraint from the snapshot
+void SpaceEventConstraint::load(SnapshotReader& r) 
+{ r.get(whichEvent, eid, meid, cid, isActiveTP, tp, isActiveCapacity, cap); }
+
 // Print a space-event constraint
 std::ostream& operator<<(std::ostream& oss, const SpaceEventConstraint& cec) {
     oss << "SpaceEventConstraint(";
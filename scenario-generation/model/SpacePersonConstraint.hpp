@@ -6,6 +6,7 @@
 #include "../utils/Typedefs.hpp"
 #include "../utils/IOUtils.hpp"
 #include "../utils/TimeProfile.hpp"
+#include "../utils/Snapshot.hpp"
 
 class SpacePersonConstraint {
 public:
@@ -22,16 +23,18 @@ public:
     MetaEventRequirements requiredMetaEventIDs;
 
     bool isActiveTP = false; // true = active TP, false = inactive TP
-    TimeProfile tp;
+    TimeProfileRef tp;
 
     // Modifiers
     void setPersonID(PersonID pid);
     void setMetaPersonID(MetaPersonID mpid);
     void setRequiredEvents(EventIDList req);
     void setRequiredMetaEvents(MetaEventRequirements req);
-    void setTimeProfile(TimeProfile tp);
+    void setTimeProfile(TimeProfileRef tp);
 
     // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     friend std::ostream& operator<<(std::ostream& oss, 
                                     const SpacePersonConstraint& cpc);
 };
@@ -65,7 +68,7 @@ void SpacePersonConstraint::setRequiredMetaEvents(MetaEventRequirements req) {
 }
 
 // Set the time profile (and flag)
-void SpacePersonConstraint::setTimeProfile(TimeProfile tp) {
+void SpacePersonConstraint::setTimeProfile(TimeProfileRef tp) {
     isActiveTP = true;
     this->tp = tp;
 }
@@ -74,6 +77,18 @@ void SpacePersonConstraint::setTimeProfile(TimeProfile tp) {
 ////////////////////////////////////////////////////////////////////////////////
 // I/O
 
+// Write the constraint into the snapshot
+void SpacePersonConstraint::save(SnapshotWriter& w) const {
+    w.put(whichPerson, pid, mpid, cid, whichEvent, requiredEventIDs, 
+          requiredMetaEventIDs, isActiveTP, tp);
+}
+
+// Read the constraint from the snapshot
+void SpacePersonConstraint::load(SnapshotReader& r) {
+    r.get(whichPerson, pid, mpid, cid, whichEvent, requiredEventIDs, 
+          requiredMetaEventIDs, isActiveTP, tp);
+}
+
 // Print a space-person constraint
 std::ostream& operator<<(std::ostream& oss, const SpacePersonConstraint& cpc) {
     oss << "SpacePersonConstraint(";
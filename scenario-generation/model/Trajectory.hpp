@@ -5,6 +5,7 @@
 
 #include "../utils/Typedefs.hpp"
 #include "../utils/DateUtils.hpp"
+#include "../utils/Snapshot.hpp"
 
 class Trajectory {
 public:
@@ -25,6 +26,8 @@ public:
     SpaceID operator[](int i) const;
 
     // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     friend std::ostream& operator<<(std::ostream& oss, const Trajectory& t);
 
 };
@@ -63,6 +66,14 @@ SpaceID Trajectory::operator[](int i) const { return traj[i]; }
 ////////////////////////////////////////////////////////////////////////////////
 // I/O
 
+// Write the trajectory into the snapshot
+void Trajectory::save(SnapshotWriter& w) const 
+{ w.put(traj, delta); }
+
+// Read the trajectory from the snapshot
+void Trajectory::load(SnapshotReader& r) 
+{ r.get(traj, delta); }
+
 // Print a trajectory
 std::ostream& operator<<(std::ostream& oss, const Trajectory& t) {
     oss << "<";
@@ -0,0 +1,68 @@
+// normalbench.cpp
+//
+// Microbenchmark of the sampling of normal distributions (samples per second)
+//
+// Compile: g++ -std=c++17 -O2 normalbench.cpp -o normalbench
+// Run    : normalbench [number-of-samples (default=20000000)]
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "utils/DateUtils.hpp"
+#include "utils/RandomGenerator.hpp"
+#include "utils/NormalDistributions.hpp"
+
+// Print the rate of n samples by f, and a checksum of the samples (so that 
+// the sampling is not optimized away)
+template<class F>
+void bench(const std::string& name, long n, F f) {
+    auto start = std::chrono::steady_clock::now();
+    double sum = f(n);
+    std::chrono::duration<double> secs = 
+            std::chrono::steady_clock::now() - start;
+    std::cout << name << ": " << n / secs.count() / 1e6 << " M/s"
+              << " (checksum " << sum << ")" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    long n = argc > 1 ? std::stol(argv[1]) : 20000000;
+
+    // The sampling of N(10min, 2min) before the ziggurat, with the polar 
+    // method of std::normal_distribution over the default random engine
+    bench("std::normal_distribution", n, [](long n) {
+        std::normal_distribution<double> distr{0, 120};
+        Time mean{"00:10:00"};
+        double sum = 0;
+        for (long i = 0; i < n; ++i)
+            sum += (mean + std::chrono::seconds{(int) distr(generator())})
+                    .count();
+        return sum;
+    });
+
+    // NormalTime::sample(), from the block of standard normal samples
+    bench("NormalTime::sample()", n, [](long n) {
+        NormalTime nt{"00:10:00", "00:02:00"};
+        double sum = 0;
+        for (long i = 0; i < n; ++i)
+            sum += nt.sample().count();
+        return sum;
+    });
+
+    // NormalTime::sample(TimeList&), in batches of 1024 samples
+    bench("NormalTime::sample(TimeList&)", n, [](long n) {
+        NormalTime nt{"00:10:00", "00:02:00"};
+        TimeList tl(1024);
+        double sum = 0;
+        for (long i = 0; i < n; i += tl.size()) {
+            nt.sample(tl);
+            for (const Time& t : tl)
+                sum += t.count();
+        }
+        return sum;
+    });
+
+    return 0;
+}
@@ -29,9 +29,7 @@ REGISTER_OBSERVATION_GENERATOR(TemperatureObservationGenerator, 3);
 int main(int argc, char* argv[]) {
 
     // Load Appropriate Data
-    DataLoader dl(argv[1]);
-    dl.loadEvents();
-    dl.loadPeople();
+    DataLoader dl(argv[1], true);
 
     // Print out data if desired
     // std::cout << dl << std::endl;
@@ -0,0 +1,233 @@
+#ifndef SYNTHETIC_DATA_GENERATOR_RESIMULATION_HPP
+#define SYNTHETIC_DATA_GENERATOR_RESIMULATION_HPP
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <string>
+#include <set>
+#include <filesystem>
+#include <system_error>
+
+#include "../include/date/date.h"
+
+#include "../model/Person.hpp"
+
+#include "../utils/Typedefs.hpp"
+#include "../utils/DateUtils.hpp"
+#include "../utils/IOUtils.hpp"
+#include "../dataloader/DataLoader.hpp"
+
+// Selects the slice of people and dates to simulate again, and reads back the
+// output of a previous run so that the rest of it can be kept. The slice is
+// specified in the (optional) `resimulation` section of the config file:
+//
+//   [resimulation]
+//   previous-output = Path to the data.csv of a previous run
+//   people          = comma separated person ids (optional)
+//   metapeople      = comma separated metaperson ids (optional)
+//   start           = DateStr (optional)
+//   end             = DateStr (optional)
+//
+// If neither people nor metapeople are given, all people are selected. If the
+// previous output is the data.csv that will be written (by any path), it is 
+// first moved to data.csv.prev.
+class Resimulation {
+public:
+
+    // A row of a previous output file
+    struct Row {
+        PersonID pid;
+        EventID eid;
+        SpaceID sid;
+        DateTime sdt, edt;
+        bool endsAttendance;
+    };
+
+    // Constructors
+    Resimulation();
+    explicit Resimulation(const DataLoader& dl);
+
+    // Queries
+    explicit operator bool() const;
+
+    bool isSelected(const Person& p) const;
+    bool isSelected(const date::sys_days& d) const;
+    bool isSelected(const Person& p, const date::sys_days& d) const;
+
+    // I/O
+    bool nextRow(const date::sys_days& d, Row& row);
+
+private:
+
+    // Reads the next row of the previous output into `pending`
+    bool readRow();
+    void error(const std::string& msg) const;
+
+    // Whether a previous output is being resimulated
+    bool active = false;
+
+    // Selected people and metapeople
+    std::set<PersonID> pids;
+    std::set<MetaPersonID> mpids;
+
+    // Selected range of dates
+    date::sys_days start, end;
+
+    // The data loader, whose people, events and spaces the rows refer to
+    const DataLoader* dl = nullptr;
+
+    // The previous output, the line last read, and the next row read from it
+    Filename fname;
+    std::ifstream prev;
+    int lineNum = 0;
+    Row pending;
+    bool hasPending = false;
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// Constructors
+
+// Default Constructor
+Resimulation::Resimulation() {}
+
+// Read the resimulation section of the config file, if there is one
+Resimulation::Resimulation(const DataLoader& dl) : dl{&dl} {
+    if (!dl.config.hasSectionOption("resimulation", "previous-output"))
+        return;
+
+    // The selected dates must be simulated, else nothing would be simulated 
+    // again
+    start = Date{dl.config("resimulation", "start",
+                           dl.config("synthetic-data-generator", "start"))};
+    end   = Date{dl.config("resimulation", "end",
+                           dl.config("synthetic-data-generator", "end"))};
+    if (end < start || start < date::sys_days{dl.start} || 
+            date::sys_days{dl.end} < end) {
+        std::cerr << "Resimulation Error: dates " << start << " to " << end 
+                  << " must be a range within the simulated dates " << dl.start 
+                  << " to " << dl.end << std::endl;
+        exitOnError();
+    }
+
+    fname = dl.config("resimulation", "previous-output");
+    Filename output = dl.config("filepaths", "output") + "data.csv";
+    std::error_code ec;
+    if (std::filesystem::exists(fname, ec) && 
+            std::filesystem::exists(output, ec) && 
+            std::filesystem::equivalent(fname, output, ec)) {
+        if (std::rename(output.c_str(), (output + ".prev").c_str()) != 0) {
+            std::cerr << "Resimulation Error: cannot move " << output 
+                      << " to " << output << ".prev" << std::endl;
+            exitOnError();
+        }
+        fname = output + ".prev";
+    }
+
+    std::cout << "... Reading previous output: " << fname << std::endl;
+    prev.open(fname);
+    if (!prev) {
+        std::cerr << "Resimulation Error: cannot read " << fname << std::endl;
+        exitOnError();
+    }
+
+    // Skip first line (header)
+    std::string header;
+    std::getline(prev, header);
+    lineNum = 1;
+
+    active = true;
+
+    for (PersonID pid : parseIntList(dl.config("resimulation", "people", "")))
+        pids.insert(pid);
+    for (MetaPersonID mpid :
+            parseIntList(dl.config("resimulation", "metapeople", "")))
+        mpids.insert(mpid);
+
+    hasPending = readRow();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// Queries
+
+// Returns true if a previous output is being resimulated
+Resimulation::operator bool() const { return active; }
+
+// Returns true if the person should be simulated again
+bool Resimulation::isSelected(const Person& p) const {
+    if (pids.empty() && mpids.empty())
+        return true;
+    return pids.find(p.id) != pids.end() || mpids.find(p.mid) != mpids.end();
+}
+
+// Returns true if the day should be simulated again
+bool Resimulation::isSelected(const date::sys_days& d) const
+{ return start <= d && d <= end; }
+
+// Returns true if the person should be simulated again on the day
+bool Resimulation::isSelected(const Person& p, const date::sys_days& d) const
+{ return isSelected(d) && isSelected(p); }
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// I/O
+
+// Returns the next row of the previous output that starts on or before day d.
+// Returns false once all such rows have been read.
+bool Resimulation::nextRow(const date::sys_days& d, Row& row) {
+    if (!hasPending || date::floor<date::days>(pending.sdt) > d)
+        return false;
+    row = pending;
+    hasPending = readRow();
+
+    // Consecutive rows of a person with the same event are a single 
+    // attendance (moving to the event space by space, then attending it). The 
+    // trajectory to an event starts in the space of the previous row, and 
+    // moves to another space at each row, so a row in the same space as the 
+    // previous one starts another attendance of the event (right after).
+    row.endsAttendance = !hasPending || 
+            pending.pid != row.pid || pending.eid != row.eid || 
+            pending.sid == row.sid;
+    return true;
+}
+
+// Read and parse the next row of the previous output. Exits if the row cannot
+// be parsed, or refers to a person, event or space that is not loaded.
+bool Resimulation::readRow() {
+    std::string line;
+    if (!std::getline(prev, line) || line.empty())
+        return false;
+    ++lineNum;
+
+    std::istringstream iss{line};
+    char sep[4];
+    date::sys_seconds sdt, edt;
+    iss >> pending.pid >> sep[0] >> pending.eid >> sep[1] >> pending.sid 
+        >> sep[2] >> date::parse("%F %T", sdt) >> sep[3] 
+        >> date::parse("%F %T", edt);
+    if (!iss || std::string(sep, 4) != ",,,,")
+        error("cannot parse row \"" + line + "\"");
+    pending.sdt = DateTime{sdt};
+    pending.edt = DateTime{edt};
+
+    if (!dl->P.contains(pending.pid))
+        error("unknown person " + std::to_string(pending.pid));
+    if (!dl->E.contains(pending.eid))
+        error("unknown event " + std::to_string(pending.eid));
+    if (!dl->C.contains(pending.sid))
+        error("unknown space " + std::to_string(pending.sid));
+    return true;
+}
+
+// Exit with the error found at the current line of the previous output
+void Resimulation::error(const std::string& msg) const {
+    std::cerr << "Resimulation Error: " << msg << " at line " << lineNum 
+              << " of " << fname << std::endl;
+    exitOnError();
+}
+
+#endif // SYNTHETIC_DATA_GENERATOR_RESIMULATION_HPP
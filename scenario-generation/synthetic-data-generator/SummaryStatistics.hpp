@@ -0,0 +1,215 @@
+#ifndef SYNTHETIC_DATA_GENERATOR_SUMMARYSTATISTICS_HPP
+#define SYNTHETIC_DATA_GENERATOR_SUMMARYSTATISTICS_HPP
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <algorithm>
+
+#include "../include/date/date.h"
+
+#include "../utils/Typedefs.hpp"
+#include "../utils/DateUtils.hpp"
+#include "../dataloader/DataLoader.hpp"
+
+namespace {
+
+    // Number of seconds in a day
+    const long DAY_SECS = 24*60*60;
+
+} // end namespace
+
+// Aggregate statistics that are maintained while synthetic data is generated,
+// so that the output does not have to be post-processed. All counters are
+// indexed by the dense indices of the data loaders, and the occupancy
+// counters only cover a single day at a time, so the memory used does not
+// grow with the number of records or the length of the simulation. The part
+// of a stay after the current day (e.g., past midnight) is kept until the 
+// following day is recorded.
+class SummaryStatistics {
+public:
+
+    // Constructors
+    SummaryStatistics();
+    SummaryStatistics(const DataLoader& dl, const Time& bin);
+
+    // Modifiers
+    void startDay(const date::sys_days& d);
+    void endDay();
+
+    void recordOccupancy(
+            Index cidx,
+            const DateTime& sdt,
+            const DateTime& edt);
+    void recordTimeBudget(
+            Index mpidx,
+            Index meidx,
+            const DateTime& sdt,
+            const DateTime& edt);
+    void recordAttendance(Index eidx);
+
+    // I/O
+    void write();
+
+private:
+
+    // Bin width (in seconds) of the occupancy counters
+    long bin;
+
+    // Number of bins in a day
+    int nBins;
+
+    // Start of the day currently being recorded
+    DateTime day;
+
+    // Ids of spaces, events, and metaentities (ordered by dense index)
+    SpaceIDList cids;
+    EventIDList eids;
+    MetaEventIDList eMids;
+    MetaPersonIDList mpids;
+    MetaEventIDList meids;
+
+    // Person-seconds spent in each (space, bin) of the current day
+    std::vector<long> occ;
+
+    // The parts of the occupancy intervals after the current day (space 
+    // index, start, end)
+    std::vector<std::tuple<Index, DateTime, DateTime>> carry;
+
+    // Number of attendances of each event
+    std::vector<long> attendance;
+
+    // Seconds spent by each (metaperson, metaevent)
+    std::vector<long> budget;
+
+    // Output files
+    std::ofstream occOut;
+    Filename outdir;
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// Constructors
+
+// Default Constructor
+SummaryStatistics::SummaryStatistics() {}
+
+// Initialize the counters for the entities in the data loader, aggregating
+// occupancy in bins of the given width
+SummaryStatistics::SummaryStatistics(const DataLoader& dl, const Time& bin)
+    : bin{std::max(1L, (long) bin.count())},
+      nBins{(int) ((DAY_SECS + this->bin - 1) / this->bin)},
+      cids{dl.C.getIDs()},
+      eids{dl.E.getIDs()},
+      mpids{dl.MP.getIDs()},
+      meids{dl.ME.getIDs()},
+      occ(cids.size() * nBins),
+      attendance(eids.size()),
+      budget(mpids.size() * meids.size()),
+      outdir{dl.config("filepaths","output")}
+{
+    eMids.reserve(eids.size());
+    for (EventID eid : eids)
+        eMids.push_back(dl.E[eid].mid);
+
+    occOut.open(outdir + "summary_occupancy.csv");
+    occOut << "SpaceID,StartDateTime,EndDateTime,AverageOccupancy"
+           << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// Modifiers
+
+// Start recording occupancy for the given day, beginning with the parts of 
+// the intervals carried over from the previous days
+void SummaryStatistics::startDay(const date::sys_days& d) {
+    day = DateTime{d};
+    std::fill(occ.begin(), occ.end(), 0);
+
+    std::vector<std::tuple<Index, DateTime, DateTime>> prev;
+    prev.swap(carry);
+    for (const auto& x : prev)
+        recordOccupancy(std::get<0>(x), std::get<1>(x), std::get<2>(x));
+}
+
+// Write out the occupancy of the current day. Only non-empty bins are written
+void SummaryStatistics::endDay() {
+    for (std::size_t i = 0; i < cids.size(); ++i) {
+        for (int b = 0; b < nBins; ++b) {
+            long x = occ[i*nBins + b];
+            if (x == 0)
+                continue;
+            long s = b * bin, e = std::min(DAY_SECS, s + bin);
+            occOut << cids[i] << ","
+                   << DateTime{day + Time{s}} << ","
+                   << DateTime{day + Time{e}} << ","
+                   << (double) x / (e - s) << "\n";
+        }
+    }
+}
+
+// Record that a person occupied the space with index cidx between the given
+// datetimes. The interval is clipped to the current day; the part after it is 
+// recorded when the following day starts.
+void SummaryStatistics::recordOccupancy(
+        Index cidx,
+        const DateTime& sdt,
+        const DateTime& edt) {
+    DateTime dayEnd{day + Time{DAY_SECS}};
+    if (dayEnd < edt)
+        carry.emplace_back(cidx, std::max(sdt, dayEnd), edt);
+
+    long s = std::max(0L, (sdt - day).count());
+    long e = std::min(DAY_SECS, (long) (edt - day).count());
+    long* row = &occ[cidx * nBins];
+    while (s < e) {
+        long b = s / bin;
+        long next = std::min(e, (b+1) * bin);
+        row[b] += next - s;
+        s = next;
+    }
+}
+
+// Record that a person of metaperson mpidx spent the given datetimes in an
+// event of metaevent meidx
+void SummaryStatistics::recordTimeBudget(
+        Index mpidx,
+        Index meidx,
+        const DateTime& sdt,
+        const DateTime& edt) {
+    if (sdt < edt)
+        budget[mpidx * meids.size() + meidx] += (edt - sdt).count();
+}
+
+// Record that the event with index eidx was attended
+void SummaryStatistics::recordAttendance(Index eidx) { ++attendance[eidx]; }
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// I/O
+
+// Write the event attendance and time budget summaries
+void SummaryStatistics::write() {
+    occOut.flush();
+
+    std::ofstream attOut{outdir + "summary_attendance.csv"};
+    attOut << "EventID,MetaEventID,Attendance" << std::endl;
+    for (std::size_t i = 0; i < eids.size(); ++i)
+        attOut << eids[i] << "," << eMids[i] << "," << attendance[i] << "\n";
+
+    std::ofstream budgetOut{outdir + "summary_time_budget.csv"};
+    budgetOut << "MetaPersonID,MetaEventID,Seconds" << std::endl;
+    for (std::size_t i = 0; i < mpids.size(); ++i) {
+        for (std::size_t j = 0; j < meids.size(); ++j) {
+            long x = budget[i * meids.size() + j];
+            if (x != 0)
+                budgetOut << mpids[i] << "," << meids[j] << "," << x << "\n";
+        }
+    }
+}
+
+#endif // SYNTHETIC_DATA_GENERATOR_SUMMARYSTATISTICS_HPP
@@ -22,6 +22,9 @@
 #include "../utils/EventLogistics.hpp"
 #include "../dataloader/DataLoader.hpp"
 
+#include "SummaryStatistics.hpp"
+#include "Resimulation.hpp"
+
 namespace {
 
     // Probability that a previous event will be attended
@@ -33,6 +36,9 @@ namespace {
     // Time spent in leisure
     static NormalTime leisureTime{"00:10:00","00:01:00"};
 
+    // Default bin width for the occupancy summary
+    const std::string DEF_SUMMARY_INTERVAL = "00:15:00";
+
 } // end namespace
 
 class SyntheticDataGenerator {
@@ -49,10 +55,12 @@ private:
 
     void arrive(Person& p, DateTime& cdt);
     void leave(Person& p, DateTime& cdt);
+    void replayPrevious(const date::sys_days& d);
 
     EventLogistics searchPrevEvents(Person& p, DateTime& currDT);
     EventLogistics searchNewEvents(Person& p, DateTime& currDT);
     void attendEvent(Person& p, const EventLogistics& el, DateTime& currDT);
+    void enroll(Person& p, const EventLogistics& el);
     EventLogistics produceLogistics(Event& e, Person& p, DateTime& currDT);
 
     EventLogistics selectEvent(
@@ -76,6 +84,11 @@ private:
 private:
 
     DataLoader dl;
+
+    // Slice of a previous output to simulate again (if any); constructed 
+    // before the output files since it may move the previous output
+    Resimulation resim;
+
     std::ofstream out, log;
 
     // Typedefs for log/cout tee
@@ -85,14 +98,20 @@ private:
     TeeDevice teedev;
     TeeStream coutlog;
 
+    // Aggregates maintained while generating logs
+    SummaryStatistics stats;
+
 };
 
 SyntheticDataGenerator::SyntheticDataGenerator(const DataLoader& dl)
     : dl{dl}, 
+      resim{dl},
       out{dl.config("filepaths","output")+"data.csv"},
       log{dl.config("filepaths","output")+"data_log.txt"},
       teedev{std::cout, log},
-      coutlog{teedev}
+      coutlog{teedev},
+      stats{dl, Time{dl.config("synthetic-data-generator", "summary-interval",
+                               DEF_SUMMARY_INTERVAL)}}
 {
     coutlog << "Starting to generate synthetic data" << std::endl << std::endl;
     out << "PersonID,EventID,SpaceID,StartDateTime,EndDateTime" << std::endl;
@@ -115,6 +134,11 @@ void SyntheticDataGenerator::generateLogs() {
         coutlog << "=======================" << std::endl;
         coutlog << "Starting day " << d << std::endl;
         coutlog << "=======================" << std::endl;
+        stats.startDay(d);
+
+        // Keep the previous output of people that are not simulated again
+        if (resim)
+            replayPrevious(d);
 
         // Iterate through all people in random order
         RandomSelector<PersonID> pids{dl.P.getIDs()};
@@ -123,6 +147,10 @@ void SyntheticDataGenerator::generateLogs() {
             // Reference to simulated person
             Person& p = dl.P[pid];
 
+            // Skip people that are kept from the previous output
+            if (resim && !resim.isSelected(p, d))
+                continue;
+
             // Determine whether person will be simulated
             TimePeriod active = dl.query(p, d);
             if (active) { // Person attends today
@@ -152,10 +180,18 @@ void SyntheticDataGenerator::generateLogs() {
             } 
         }
 
+        stats.endDay();
         coutlog << "=======================" << std::endl;
         coutlog << "Finished day " << d << std::endl;
         coutlog << "=======================" << std::endl << std::endl;
     }
+
+    // Keep the remainder of the previous output
+    if (resim)
+        replayPrevious(date::sys_days::max());
+
+    // Write the aggregates collected over the simulation
+    stats.write();
 }
 
 // Bookkeeping for when person arrives. Record that the person spends the time
@@ -169,12 +205,38 @@ void SyntheticDataGenerator::arrive(Person& p, DateTime& currDT) {
 // they stay there until the end of the day.
 void SyntheticDataGenerator::leave(Person& p, DateTime& currDT) {
     move(p, dl.E.getOutEvent(), 
-            dl.MT.getPath(p.getCurrentSpace(), dl.C.getOutsideSpaceID()), 
+            dl.MT.getPath(p.getCurrentSpace(), dl.C.getOutsideSpaceID(), 
+                          currDT), 
             currDT);
     record(p, dl.E.getOutEvent(), dl.C.getOutsideSpace(), 
             currDT, currDT.lastTime());
 }
 
+// Keep the rows of the previous output up to day d that are not simulated 
+// again. Kept rows are copied to the output, and replayed into the occupancy 
+// of spaces, the enrollment of events, and the attended events of people, so
+// that the people simulated again interact with them as before. As in a 
+// simulated day, the out event (of arrive() and leave()) is only recorded.
+void SyntheticDataGenerator::replayPrevious(const date::sys_days& d) {
+    Resimulation::Row row;
+    while (resim.nextRow(d, row)) {
+        Person& p = dl.P[row.pid];
+        if (resim.isSelected(p, date::floor<date::days>(row.sdt)))
+            continue;
+
+        record(p, dl.E[row.eid], dl.C[row.sid], row.sdt, row.edt);
+
+        if (row.endsAttendance && row.eid != dl.E.getOutEventID()) {
+            EventLogistics el;
+            el.eid  = row.eid;
+            el.meid = dl.E[row.eid].mid;
+            el.sid  = row.sid;
+            el.tp   = TimePeriod{row.sdt, row.edt};
+            enroll(p, el);
+        }
+    }
+}
+
 // Look for a previous (periodic) event to attend
 EventLogistics SyntheticDataGenerator::searchPrevEvents(
         Person& p, 
@@ -190,7 +252,7 @@ EventLogistics SyntheticDataGenerator::searchPrevEvents(
         TimePeriod tp = dl.query(dl.E[el.eid], currDT);
         if (tp) {
             coutlog << "    considering past event " << el << std::endl;
-            el.traj = dl.MT.getPath(p.getCurrentSpace(), el.sid);
+            el.traj = dl.MT.getPath(p.getCurrentSpace(), el.sid, currDT);
             el.tp = tp; 
             possible.push_back(el);
         }
@@ -208,13 +270,25 @@ EventLogistics SyntheticDataGenerator::searchNewEvents(
         Person& p, 
         DateTime& currDT) {
     // Collect a list of events that p can attend. An attendable event will be
-    // indicated with its associated event logistics.
-    std::vector<EventLogistics> possible;
-    for (Event& e : dl.E) {
-        EventLogistics el = produceLogistics(e, p, currDT);
+    // indicated with its associated event logistics. Only events that the 
+    // metaperson of p still has capacity for are considered.
+    std::vector<EventLogistics> candidates;
+    std::vector<CEKey> keys;
+    for (Index i : dl.E.getCandidates(p.midx)) {
+        EventLogistics el = produceLogistics(dl.E.getByIndex(i), p, currDT);
         if (el) {
-            coutlog << "    consider new event " << el << std::endl;
-            possible.push_back(el);
+            candidates.push_back(el);
+            keys.push_back(std::make_pair(el.sid, el.eid));
+        }
+    }
+
+    // Check the CP, CE, PE constraints of all candidates at once
+    std::vector<std::uint64_t> ok = dl.CS.checkConstraints(p, currDT, keys);
+    std::vector<EventLogistics> possible;
+    for (std::size_t i = 0; i < candidates.size(); ++i) {
+        if (ok[i / 64] >> (i % 64) & 1) {
+            coutlog << "    consider new event " << candidates[i] << std::endl;
+            possible.push_back(candidates[i]);
         }
     }
 
@@ -227,7 +301,7 @@ EventLogistics SyntheticDataGenerator::searchNewEvents(
     leisure.eid  = dl.E.getLeisureEventID();
     leisure.meid = dl.ME.getLeisureMetaEventID();
     leisure.sid  = dl.C.getOutsideSpaceID();
-    leisure.traj = dl.MT.getPath(p.getCurrentSpace(), leisure.sid);
+    leisure.traj = dl.MT.getPath(p.getCurrentSpace(), leisure.sid, currDT);
     leisure.tp   = TimePeriod{currDT, DateTime{currDT+leisureTime.sample()}};
     return leisure;
 }
@@ -243,14 +317,17 @@ EventLogistics SyntheticDataGenerator::produceLogistics(
     el.eid  = e.id;
     el.meid = e.mid;
 
-    // Check event capacity; the leisure event is always attendable
-    if (e.cap.find(-1) != e.cap.end() || // leisure event
-        e.canAttend(p.mid)) {            // can metaperson attend?
+    // Check event capacity; events with unlimited capacity (e.g., the leisure
+    // event) are always attendable
+    if (e.canAttend(p.midx)) {
 
-        // Check event space's capacity and trajectory to space
+        // Check event space's capacity and trajectory to space; spaces that 
+        // cannot be reached (e.g., closed) are skipped
         std::vector<Trajectory> tl;
         for (SpaceID c : e.spaces) {
-            const Trajectory& t = dl.MT.getPath(p.getCurrentSpace(), c);
+            Trajectory t = dl.MT.getPath(p.getCurrentSpace(), c, currDT);
+            if (!t.empty() && t.dest() != c)
+                continue;
             DateTime expArrival{currDT + t.totalTime()};
             if (dl.C[c].cap == -1 || 
                 dl.C[c].getOccupancy(expArrival)+1 < dl.C[c].cap)
@@ -271,16 +348,10 @@ EventLogistics SyntheticDataGenerator::produceLogistics(
         el.tp = dl.query(e, currDT);
 
         // If a valid time profile does not exist for the person, then they 
-        // cannot attend the event. 
+        // cannot attend the event. (The constraints are checked by the caller, 
+        // for all candidate events at once.)
         if (!el.tp)
             return EventLogistics{};
-
-        // Check CP, CE, PE constraints
-        if (!dl.CS.checkCPConstraints(el.sid, p.id, currDT) || 
-            !dl.CS.checkCEConstraints(el.sid, e.id, currDT) ||
-            !dl.CS.checkPEConstraints(p.id,   e.id, currDT)) {
-            return EventLogistics{};
-        }
     }
 
     return el;
@@ -320,14 +391,21 @@ void SyntheticDataGenerator::attendEvent(
         const EventLogistics& el, 
         DateTime& currDT) {
     coutlog << "Person " << p.id << ": " << el << std::endl;
+    enroll(p, el);
+    move(p, dl.E[el.eid], el.traj, currDT);
+    record(p,dl.E[el.eid], dl.C[el.sid], currDT, el.tp.end());
+    currDT = el.tp.end();
+}
+
+// Bookkeeping for when person p attends the event in the event logistics
+void SyntheticDataGenerator::enroll(Person& p, const EventLogistics& el) {
     if (el.eid != dl.E.getLeisureEventID() && // do not record leisure event
         el.eid != dl.E.getOutEventID()) {     // do not record out event
         p.addAttendedEvent(el);
-        dl.E[el.eid].enrollMetaPerson(p.mid);
+        dl.CS.addAttendance(p, el);
+        dl.E.enrollMetaPerson(dl.E.getIndex(el.eid), p.midx);
     }
-    move(p, dl.E[el.eid], el.traj, currDT);
-    record(p,dl.E[el.eid], dl.C[el.sid], currDT, el.tp.end());
-    currDT = el.tp.end();
+    stats.recordAttendance(dl.E.getIndex(el.eid));
 }
 
 // Move the person to the event using the given trajectory
@@ -361,6 +439,9 @@ void SyntheticDataGenerator::record(
         const DateTime& edt) {
     p.setCurrentSpace(c.id);
     c.insertOccupancy(sdt,edt); 
+    stats.recordOccupancy(dl.C.getIndex(c.id), sdt, edt);
+    stats.recordTimeBudget(dl.MP.getIndex(p.mid), dl.ME.getIndex(e.mid), 
+            sdt, edt);
     out << p.id << "," 
         << e.id << "," 
         << c.id << ","
@@ -6,6 +6,7 @@
 #include <fstream>
 #include <vector>
 #include <utility>
+#include <algorithm>
 
 #include "../include/date/date.h"
 
@@ -201,4 +202,69 @@ typedef std::vector<Time> TimeList;
 // A list of datetimes
 typedef std::vector<DateTime> DateTimeList;
 
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// DateBitset
+
+// A set of dates within a fixed range of days, stored as one bit per day
+class DateBitset {
+public:
+
+    // Constructors
+    DateBitset();
+    DateBitset(const Date& s, const Date& e);
+
+    // Queries
+    bool covers(const date::sys_days& d) const;
+    bool contains(const date::sys_days& d) const;
+    DateList dates() const;
+
+    // Modifiers
+    void insert(const date::sys_days& d);
+
+private:
+
+    // First day of the range
+    date::sys_days s;
+
+    // One bit for each day of the range
+    std::vector<bool> bits;
+
+};
+
+// Default Constructor
+DateBitset::DateBitset() {}
+
+// Construct an empty set over the days s to e (inclusive)
+DateBitset::DateBitset(const Date& s, const Date& e) : s{s} 
+{ bits.resize(std::max(0L, (long) (date::sys_days{e} - this->s).count() + 1)); }
+
+// Return whether day d is within the range of the set
+bool DateBitset::covers(const date::sys_days& d) const {
+    long i = (d - s).count();
+    return 0 <= i && (std::size_t) i < bits.size();
+}
+
+// Return whether the set contains day d (false for days outside the range)
+bool DateBitset::contains(const date::sys_days& d) const {
+    long i = (d - s).count();
+    return 0 <= i && (std::size_t) i < bits.size() && bits[i];
+}
+
+// Return the list of dates in the set
+DateList DateBitset::dates() const {
+    DateList dl;
+    for (std::size_t i = 0; i < bits.size(); ++i)
+        if (bits[i])
+            dl.push_back(Date{s + date::days{(long) i}});
+    return dl;
+}
+
+// Add day d to the set; days outside the range are ignored
+void DateBitset::insert(const date::sys_days& d) {
+    long i = (d - s).count();
+    if (0 <= i && (std::size_t) i < bits.size())
+        bits[i] = true;
+}
+
 #endif // UTILS_DATEUTILS_HPP
@@ -0,0 +1,32 @@
+#ifndef UTILS_DISTANCES_HPP
+#define UTILS_DISTANCES_HPP
+
+#include <cmath>
+#include <cstddef>
+
+#include "Typedefs.hpp"
+
+// A view of n points in structure of arrays form: point i is (x[i],y[i],z[i])
+struct PointsView {
+    const double* x;
+    const double* y;
+    const double* z;
+    std::size_t n;
+};
+
+// Write the manhattan distances from (x,y,z) to the points with indices
+// idx[0..n) into out
+void manhattanDistances(
+        double x, double y, double z, 
+        const PointsView& p, 
+        const Index* idx, 
+        std::size_t n, 
+        double* out) {
+    for (std::size_t i = 0; i < n; ++i) {
+        std::size_t j = idx[i];
+        out[i] = std::fabs(p.x[j]-x) + std::fabs(p.y[j]-y) + 
+                 std::fabs(p.z[j]-z);
+    }
+}
+
+#endif // UTILS_DISTANCES_HPP
@@ -4,46 +4,158 @@
 #include <iostream>
 #include <fstream>
 #include <cstdlib>
-#include <string>
+#include <cstdint>
+#include <cmath>
+#include <cstdio>
 #include <cstring>
+#include <string>
 #include <vector>
 #include <map>
 #include <set>
+#include <list>
+#include <queue>
 #include <algorithm>
+#include <functional>
 #include <utility>
 #include <limits>
+#include <tuple>
+#include <atomic>
 
+#include "../model/Closure.hpp"
 #include "../dataloader/SpacesLoader.hpp"
 
 #include "Typedefs.hpp"
 #include "IOUtils.hpp"
+#include "NormalDistributions.hpp"
+#include "Distances.hpp"
+#include "ThreadPool.hpp"
 
 namespace {
 
-// A map of the distance to go to a space 
-typedef std::map<SpaceID, double> Dist;
+// The distance to go to each space (by dense index)
+typedef std::vector<double> Dist;
+
+// The previous space (by dense index) to reach each space, or -1
+typedef std::vector<Index> Prev;
+
+// An entry of the predecessor matrix: the dense index of the previous space, 
+// or noPred
+typedef std::uint16_t PredIndex;
+const PredIndex noPred = std::numeric_limits<PredIndex>::max();
 
-// A map of the previous space to reach a space
-typedef std::map<SpaceID, SpaceID> Prev;
+// The header of the binary path cache, which is followed by the frozen graph 
+// it was computed on (n space ids, n+1 offsets, m targets and m weights) and 
+// by the n x n predecessor matrix. The fingerprint hashes the frozen graph, 
+// so a cache of another graph is detected (and updated).
+struct PathCacheHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t n;
+    std::uint32_t m;
+    std::uint32_t reserved;
+    std::uint64_t fingerprint;
+};
+
+const char pathCacheMagic[8] = {'S','S','P','A','T','H','S','\0'};
+const std::uint32_t pathCacheVersion = 2;
+
+// Dijkstra's algorithm over a graph in compressed sparse row form (the edges 
+// of u are [offsets[u], offsets[u+1]) of targets/weights), with a binary 
+// heap. Ties are broken by index. Edges i with (*closed)[i] are skipped.
+void dijkstraCSR(
+        const std::vector<int>& offsets, 
+        const std::vector<Index>& targets, 
+        const std::vector<double>& weights,
+        Index s, 
+        Dist& D, 
+        Prev& P,
+        const std::vector<bool>* closed=nullptr) {
+    D.assign(offsets.size()-1, std::numeric_limits<double>::infinity());
+    P.assign(offsets.size()-1, -1);
+    D[s] = 0;
+
+    typedef std::pair<double, Index> Entry;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> Q;
+    Q.push(Entry{0, s});
+    while (!Q.empty()) {
+        Entry x = Q.top();
+        Q.pop();
+        Index u = x.second;
+        if (x.first > D[u]) // already visited with a shorter distance
+            continue;
+        for (int i = offsets[u]; i < offsets[u+1]; ++i) {
+            Index v = targets[i];
+            if (closed && (*closed)[i])
+                continue;
+            if (D[u] + weights[i] < D[v]) {
+                D[v] = D[u] + weights[i];
+                P[v] = u;
+                Q.push(Entry{D[v], v});
+            }
+        }
+    }
+}
+
+// Call f(i, D, P) for each i in [0, n) on the thread pool, where D and P are 
+// scratch space of the thread
+template<class F>
+void parallelPaths(Index n, F f) {
+    parallelFor(n, [&f](Index i) {
+        thread_local Dist D;
+        thread_local Prev P;
+        f(i, D, P);
+    });
+}
 
 } // end namespace
 
+// How shortest paths are found:
+//  - AllPairs: all pairs are precomputed (and saved to the paths-cache file)
+//  - Lazy: each path is found on first use with A*, and kept in an LRU cache 
+//    of at most lazyBytes
+//  - Hierarchical: spaces are partitioned into clusters (by their cluster 
+//    attribute, or else by floor and by cells of clusterSize in x and y, if 
+//    clusterSize > 0); paths within each cluster and between the boundary 
+//    spaces of the clusters are precomputed, and stitched together
+// In all-pairs mode, up to alternatives routes are given between each 
+// src/dest (see alternativePaths), at most stretch times as long as the 
+// shortest path.
+enum class PathMode { AllPairs, Lazy, Hierarchical };
+
+struct PathOptions {
+    PathMode mode = PathMode::AllPairs;
+    std::size_t lazyBytes = std::size_t{64} << 20;
+    double clusterSize = 0;
+    int alternatives = 1;
+    double stretch = 1.5;
+};
+
 class SpacesGraph {
 public: 
     
     // Constructors
     SpacesGraph();
-    SpacesGraph(SpacesLoader& cl, const Filename& cache);
+    SpacesGraph(
+            SpacesLoader& cl, 
+            const Filename& cache, 
+            const PathOptions& opts=PathOptions{});
 
     // Queries
     const SpaceIDSet& getV() const;
     const std::map<SpaceID, SpaceIDSet>& getE() const;
-    const SpaceIDList& shortestPath(SpaceID s, SpaceID t) const;
+    SpaceIDList shortestPath(SpaceID s, SpaceID t) const;
+    SpaceIDList shortestPath(SpaceID s, SpaceID t, const DateTime& dt) const;
+    std::vector<SpaceIDList> alternativePaths(SpaceID s, SpaceID t) const;
+    TimeList travelTimes(const SpaceIDList& sl) const;
+
+    Index closuresAt(const DateTime& dt) const;
+    bool isOpen(const SpaceIDList& sl, Index set) const;
 
     // Modifiers
     void addNode(SpaceID s);
     void addEdge(SpaceID s, SpaceID t);
     void cacheAllShortestPaths();
+    void setClosures(const std::vector<Closure>& closures);
 
     // I/O
     friend std::ostream& operator<<(std::ostream& oss, const SpacesGraph& g);
@@ -51,21 +163,127 @@ public:
 private:
 
     // Private helper methods
-    void cacheShortestPath(SpaceID s);
-    std::pair<Dist, Prev> dijkstra(SpaceID s) const;
-    std::pair<Dist, Prev> bfs(SpaceID s) const;
+    SpaceIDList route(SpaceID s, SpaceID t, Index set) const;
+    SpaceIDList path(Index s, Index t, Index set=-1) const;
+    SpaceIDList rowPath(const PredIndex* row, Index s, Index t) const;
+    double length(const SpaceIDList& sl) const;
+    void cacheAlternatives();
+    void freeze();
+    void buildClosureSet(const std::vector<Closure>& closures, 
+                         const IndexList& active);
+    Index edgeIndex(Index u, Index v) const;
+    void cacheShortestPath(Index s, Dist& D, Prev& P);
+    void dijkstra(Index s, Dist& D, Prev& P) const;
+    void bfs(Index s, Dist& D, Prev& P) const;
+    SpaceIDList astar(Index s, Index t, Index set) const;
+    double heuristic(Index u, Index t) const;
+    void buildHierarchy();
+    SpaceIDList hierarchicalPath(Index s, Index t) const;
+    void appendClusterPath(Index c, Index a, Index b, SpaceIDList& sl) const;
+    void appendOverlayPath(Index a, Index b, SpaceIDList& sl) const;
+    std::uint64_t fingerprint() const;
     bool loadSpacesCache();
+    void updateSpacesCache(const MappedFile& file, const PathCacheHeader& h);
     void writeSpacesCache();
     
-    // A map of shortest path between a src/dest
-    std::map<SrcDest, SpaceIDList> paths;
-
     // The set of vertices (space ids)
     SpaceIDSet V;
 
     // The set of edges (edge list)
     std::map<SpaceID, SpaceIDSet> E;
 
+    // The graph frozen into compressed sparse row form (see freeze()): the 
+    // space id of each dense index, and the edges of index u, stored at 
+    // [offsets[u], offsets[u+1]) of targets/weights
+    SpaceIDList ids;
+    SpaceIDIndexMap loc;
+    std::vector<int> offsets;
+    std::vector<Index> targets;
+    std::vector<double> weights;
+
+    // The travel time of each edge (as in targets), in seconds: normal with 
+    // mean 5d and stdev d, for the distance d between the spaces
+    std::vector<double> travelMean;
+    std::vector<double> travelStdev;
+
+    // The coordinates of each dense index (as structure of arrays), for the 
+    // edge weights and the A* heuristic; spaces without coordinates have NaN
+    std::vector<double> xs;
+    std::vector<double> ys;
+    std::vector<double> zs;
+
+    // The shortest paths between all src/dest, as a dense V x V predecessor 
+    // matrix: pred[s*V+t] is the dense index of the space before t on the 
+    // path from s to t (noPred if t is s or is unreachable)
+    std::vector<PredIndex> pred;
+
+    // The alternative routes, as alternatives-1 more predecessor matrices 
+    // (one after the other) of the trees of penalized shortest paths
+    std::vector<PredIndex> altPred;
+
+    // The closures of spaces and passages, in epochs over which they do not 
+    // change: the start of each epoch, and its closure set (or -1 if nothing 
+    // is closed)
+    std::vector<DateTime> epochStart;
+    IndexList epochSet;
+
+    // For each distinct closure set: the closed edges (by index, as in 
+    // targets; edges into a closed space are closed), and the closed edges 
+    // as (u,v) pairs. In all-pairs mode, the rows of the predecessor matrix 
+    // are repaired for the sources whose shortest path tree uses a closed 
+    // edge: rowOf[s] is the repaired row of source s in rows, or -1.
+    struct ClosureSet {
+        std::vector<bool> closed;
+        std::vector<std::pair<Index, Index>> edges;
+        IndexList rowOf;
+        std::vector<PredIndex> rows;
+    };
+    std::vector<ClosureSet> closureSets;
+
+    // In lazy mode (and in hierarchical mode, under closures), the paths 
+    // found so far by (src/dest, closure set), most recently used first, and 
+    // their approximate size in bytes
+    typedef std::pair<SrcDest, Index> PathKey;
+    typedef std::list<std::pair<PathKey, SpaceIDList>> LRUList;
+    mutable LRUList lru;
+    mutable std::map<PathKey, LRUList::iterator> lruLoc;
+    mutable std::size_t lruBytes = 0;
+
+    // Scratch space for A*: D and P of index v are only valid if seen[v] is 
+    // the stamp of the current search
+    mutable Dist astarD;
+    mutable Prev astarP;
+    mutable std::vector<unsigned> seen;
+    mutable unsigned stamp = 0;
+
+    // In hierarchical mode, the clusters of spaces: for each cluster, the 
+    // dense indices of its spaces, the local indices of its boundary spaces 
+    // (with an edge to or from another cluster), and the distances and 
+    // predecessors (local indices, as in pred) of the paths within it
+    struct Cluster {
+        IndexList members;
+        IndexList boundary;
+        std::vector<double> dist;
+        std::vector<PredIndex> pred;
+    };
+    std::vector<Cluster> clusters;
+
+    // In hierarchical mode, the cluster and local index of each dense index
+    IndexList clusterOf;
+    IndexList localOf;
+
+    // In hierarchical mode, the overlay graph of the boundary spaces (edges 
+    // between clusters, and shortcuts through clusters): the overlay index of 
+    // each dense index (or -1), the dense index of each boundary space, and 
+    // the B x B distances and predecessors (overlay indices) between them
+    IndexList overlayOf;
+    IndexList overlayIds;
+    std::vector<double> odist;
+    std::vector<PredIndex> opred;
+
+    // How shortest paths are found
+    PathOptions opts;
+
     // Represents whether the paths are cached between src/dest
     bool cache;
 
@@ -88,8 +306,11 @@ SpacesGraph::SpacesGraph()
 }
 
 // Construct the spaces graph from the given spaces, and cache it
-SpacesGraph::SpacesGraph(SpacesLoader& cl, const Filename& cache) 
-: cache{true}, fcache{cache}, cl{cl} {
+SpacesGraph::SpacesGraph(
+        SpacesLoader& cl, 
+        const Filename& cache, 
+        const PathOptions& opts) 
+: opts{opts}, cache{true}, fcache{cache}, cl{cl} {
     V.insert(0); // outside SpaceID
     for (const Space& c : cl) {
         addNode(c.id);
@@ -109,24 +330,93 @@ const SpaceIDSet& SpacesGraph::getV() const { return V; }
 // Return the set of edges
 const std::map<SpaceID, SpaceIDSet>& SpacesGraph::getE() const { return E; }
 
-// Return the shortest path between a src/dest.
-const SpaceIDList& SpacesGraph::shortestPath(SpaceID s, SpaceID t) const {
-    // Shortest paths must be cached first
-    if (!cache) {
-        std::cerr << "SpacesGraph Error: cache paths first" << std::endl;
-        std::exit(1);
+// Return the shortest path between a src/dest, ignoring closures. If t is 
+// unreachable from s, the path is {s}.
+SpaceIDList SpacesGraph::shortestPath(SpaceID s, SpaceID t) const 
+{ return route(s, t, -1); }
+
+// Return the shortest path between a src/dest at datetime dt, avoiding the 
+// spaces and passages closed at dt. If t is unreachable from s, the path is 
+// {s}.
+SpaceIDList SpacesGraph::shortestPath(
+        SpaceID s, 
+        SpaceID t, 
+        const DateTime& dt) const 
+{ return route(s, t, closuresAt(dt)); }
+
+// Return the distinct routes between a src/dest, ignoring closures: the 
+// shortest path first, then the paths in the trees of alternative routes 
+// that are at most stretch times as long. Without alternative routes, only 
+// the shortest path is returned.
+std::vector<SpaceIDList> SpacesGraph::alternativePaths(
+        SpaceID s, 
+        SpaceID t) const {
+    std::vector<SpaceIDList> paths{shortestPath(s,t)};
+    if (altPred.empty())
+        return paths;
+
+    std::size_t n = ids.size();
+    Index si = loc.at(s), ti = loc.at(t);
+    double maxLength = opts.stretch * length(paths[0]);
+    for (std::size_t i = 0; i < altPred.size(); i += n*n) {
+        SpaceIDList sl = rowPath(&altPred[i + si*n], si, ti);
+        if (length(sl) <= maxLength && 
+                std::find(paths.begin(), paths.end(), sl) == paths.end())
+            paths.push_back(sl);
     }
-    
-    // Try to find a path between the src/dest
-    auto path = paths.find(std::make_pair(s,t));
-    if (path == paths.end()) {
-        std::cerr << "SpacesGraph Error: no path found between " 
-                << s << " and " << t << std::endl;
-        std::exit(1);
+    return paths;
+}
+
+// Return a sample of the time taken by each hop of the path, from the travel 
+// times of the edges; the standard normal samples for all hops are drawn at 
+// once. A hop that is not an edge takes the time of the distance between its 
+// spaces (or none, without coordinates).
+TimeList SpacesGraph::travelTimes(const SpaceIDList& sl) const {
+    TimeList tl(sl.empty() ? 0 : sl.size()-1);
+    std::vector<double> z(tl.size());
+    standardNormals(z);
+    Index u = sl.empty() ? -1 : loc.at(sl[0]);
+    for (std::size_t i = 0; i < tl.size(); ++i) {
+        Index v = loc.at(sl[i+1]);
+        Index e = edgeIndex(u, v);
+        double mean, stdev;
+        if (e != -1) {
+            mean = travelMean[e];
+            stdev = travelStdev[e];
+        }
+        else {
+            int d = heuristic(u, v);
+            mean = 5 * d;
+            stdev = d;
+        }
+        tl[i] = Time{(int) mean + (int) (stdev * z[i])};
+        u = v;
     }
+    return tl;
+}
 
-    // Return cached path
-    return path->second;
+// Return the closure set at datetime dt, or -1 if nothing is closed
+Index SpacesGraph::closuresAt(const DateTime& dt) const {
+    auto it = std::upper_bound(epochStart.begin(), epochStart.end(), dt);
+    return it == epochStart.begin() ? -1 : epochSet[it - epochStart.begin()-1];
+}
+
+// Return true if the path does not use a passage (or enter a space) closed 
+// in the closure set
+bool SpacesGraph::isOpen(const SpaceIDList& sl, Index set) const {
+    if (set == -1)
+        return true;
+    const std::vector<bool>& closed = closureSets[set].closed;
+    for (std::size_t i = 0; i+1 < sl.size(); ++i) {
+        auto u = loc.find(sl[i]);
+        auto v = loc.find(sl[i+1]);
+        if (u == loc.end() || v == loc.end())
+            continue;
+        Index e = edgeIndex(u->second, v->second);
+        if (e != -1 && closed[e])
+            return false;
+    }
+    return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -147,15 +437,95 @@ void SpacesGraph::addEdge(SpaceID s, SpaceID t) {
     E[s].insert(t);
 }
 
-// Cache all shortest paths into the file
+// Cache all shortest paths into the file. Without a valid cache file, the 
+// paths from each source are found by a pool of threads (one source per 
+// task), each writing only to the row of its source in the predecessor 
+// matrix, and the cache file is rewritten; then the alternative routes are 
+// found. In lazy mode, only the graph is frozen; in hierarchical mode, the 
+// cluster and overlay tables are built instead. Previously found paths and 
+// closures are dropped.
 void SpacesGraph::cacheAllShortestPaths() {
+    freeze();
+    altPred.clear();
+    epochStart.clear();
+    epochSet.clear();
+    closureSets.clear();
+    lru.clear();
+    lruLoc.clear();
+    lruBytes = 0;
+    if (opts.mode != PathMode::AllPairs && opts.alternatives > 1)
+        std::cerr << "SpacesGraph Warning: alternative routes are only found " 
+                  << "in all-pairs mode" << std::endl;
+    if (opts.mode == PathMode::Hierarchical) {
+        buildHierarchy();
+        cache = true;
+        return;
+    }
+    if (opts.mode == PathMode::Lazy) {
+        cache = true;
+        return;
+    }
+
+    if (ids.size() >= noPred) {
+        std::cerr << "SpacesGraph Error: too many spaces (" << ids.size() 
+                  << ") for all-pairs paths; at most " << noPred-1 
+                  << " are supported (use the lazy or hierarchical mode)" 
+                  << std::endl;
+        exitOnError();
+    }
+    pred.assign(ids.size() * ids.size(), noPred);
     if (!loadSpacesCache()) {
-        for (SpaceID s : V) {
-            cacheShortestPath(s);
-        }
+        parallelPaths(ids.size(), [this](Index s, Dist& D, Prev& P) {
+            cacheShortestPath(s, D, P);
+        });
+        writeSpacesCache();
     }
+    cacheAlternatives();
     cache = true;
-    writeSpacesCache();
+}
+
+// Set the closures of spaces and passages (the graph must be cached first). 
+// The closures split time into epochs; the paths of each distinct set of 
+// closures are repaired from the paths without closures.
+void SpacesGraph::setClosures(const std::vector<Closure>& closures) {
+    if (!cache) {
+        std::cerr << "SpacesGraph Error: cache paths first" << std::endl;
+        exitOnError();
+    }
+
+    epochStart.clear();
+    for (const Closure& c : closures) {
+        epochStart.push_back(c.start);
+        epochStart.push_back(c.end);
+    }
+    std::sort(epochStart.begin(), epochStart.end());
+    epochStart.erase(std::unique(epochStart.begin(), epochStart.end()), 
+                     epochStart.end());
+
+    epochSet.clear();
+    closureSets.clear();
+    std::map<IndexList, Index> sets;
+    for (const DateTime& dt : epochStart) {
+        IndexList active;
+        for (std::size_t i = 0; i < closures.size(); ++i)
+            if (closures[i].start <= dt && dt < closures[i].end)
+                active.push_back(i);
+        if (active.empty()) {
+            epochSet.push_back(-1);
+            continue;
+        }
+
+        auto it = sets.find(active);
+        if (it == sets.end()) {
+            it = sets.emplace(active, closureSets.size()).first;
+            buildClosureSet(closures, active);
+        }
+        epochSet.push_back(it->second);
+    }
+
+    lru.clear();
+    lruLoc.clear();
+    lruBytes = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -177,80 +547,630 @@ std::ostream& operator<<(std::ostream& oss, const SpacesGraph& g) {
 ////////////////////////////////////////////////////////////////////////////////
 // Private Helpers
 
-// Use Dijkstra's algorithm to find the shortest paths between nodes
-void SpacesGraph::cacheShortestPath(SpaceID s) {
-    std::pair<Dist, Prev> DP = dijkstra(s);
-    for (SpaceID t : V) {
-        SrcDest sd(s,t);
-        SpaceIDList path;
-        while (s != t) {
-            path.push_back(t);
-            auto prev = DP.second.find(t);
-            if (prev != DP.second.end())
-                t = prev->second;
-            else {
-                path.clear();
+// Return the shortest path between a src/dest under the closure set (or 
+// none, if -1), reconstructed from the predecessor matrix (or, in lazy mode, 
+// from the LRU cache or A*; or, in hierarchical mode, from the cluster and 
+// overlay tables, or under closures, as in lazy mode).
+SpaceIDList SpacesGraph::route(SpaceID s, SpaceID t, Index set) const {
+    // Shortest paths must be cached first
+    if (!cache) {
+        std::cerr << "SpacesGraph Error: cache paths first" << std::endl;
+        exitOnError();
+    }
+    
+    // Try to find a path between the src/dest
+    auto sit = loc.find(s);
+    auto tit = loc.find(t);
+    if (sit == loc.end() || tit == loc.end()) {
+        std::cerr << "SpacesGraph Error: no path found between " 
+                << s << " and " << t << std::endl;
+        exitOnError();
+    }
+
+    if (opts.mode == PathMode::AllPairs)
+        return path(sit->second, tit->second, set);
+    if (opts.mode == PathMode::Hierarchical && set == -1)
+        return hierarchicalPath(sit->second, tit->second);
+
+    // Move a cached path to the front
+    PathKey key{SrcDest{s,t}, set};
+    auto it = lruLoc.find(key);
+    if (it != lruLoc.end()) {
+        lru.splice(lru.begin(), lru, it->second);
+        return it->second->second;
+    }
+
+    // Find and cache the path, evicting the least recently used paths
+    SpaceIDList sl = astar(sit->second, tit->second, set);
+    lru.emplace_front(key, sl);
+    lruLoc[key] = lru.begin();
+    lruBytes += sizeof(LRUList::value_type) + sl.size() * sizeof(SpaceID);
+    while (lruBytes > opts.lazyBytes && lru.size() > 1) {
+        const LRUList::value_type& e = lru.back();
+        lruBytes -= sizeof(LRUList::value_type) + 
+                    e.second.size() * sizeof(SpaceID);
+        lruLoc.erase(e.first);
+        lru.pop_back();
+    }
+    return sl;
+}
+
+// Return the path between the spaces with dense indices s and t, walking back 
+// from t along row s of the predecessor matrix (or its repaired row under the 
+// closure set)
+SpaceIDList SpacesGraph::path(Index s, Index t, Index set) const {
+    std::size_t n = ids.size();
+    const PredIndex* row = &pred[s * n];
+    if (set != -1 && closureSets[set].rowOf[s] != -1)
+        row = &closureSets[set].rows[closureSets[set].rowOf[s] * n];
+    return rowPath(row, s, t);
+}
+
+// Return the path between the spaces with dense indices s and t, walking back 
+// from t along the row of predecessors of s
+SpaceIDList SpacesGraph::rowPath(const PredIndex* row, Index s, Index t) const {
+    std::size_t n = ids.size();
+    SpaceIDList sl;
+    for (Index v = t; row[v] != noPred && sl.size() < n; v = row[v])
+        sl.push_back(ids[v]);
+    sl.push_back(ids[s]);
+    std::reverse(sl.begin(), sl.end());
+    return sl;
+}
+
+// Return the length of the path (the sum of the distances between spaces)
+double SpacesGraph::length(const SpaceIDList& sl) const {
+    double d = 0;
+    for (std::size_t i = 1; i < sl.size(); ++i)
+        d += cl.dist(sl[i-1], sl[i]);
+    return d;
+}
+
+// Find the trees of alternative routes from each source (by a pool of 
+// threads, one source per task): each tree is the tree of shortest paths 
+// after doubling the weight of the edges in the previous trees from the 
+// source, so that the routes spread over other passages.
+void SpacesGraph::cacheAlternatives() {
+    if (opts.alternatives <= 1)
+        return;
+    std::size_t n = ids.size();
+    altPred.assign((opts.alternatives-1) * n * n, noPred);
+    parallelPaths(n, [this, n](Index s, Dist& D, Prev& P) {
+        std::vector<double> w = weights;
+        const PredIndex* prev = &pred[s * n];
+        for (std::size_t i = 0; i < altPred.size(); i += n*n) {
+            for (std::size_t v = 0; v < n; ++v)
+                if (prev[v] != noPred)
+                    w[edgeIndex(prev[v], v)] *= 2;
+            dijkstraCSR(offsets, targets, w, s, D, P);
+            PredIndex* row = &altPred[i + s*n];
+            for (Index v = 0; v < (Index) n; ++v)
+                row[v] = (v == s || P[v] == -1) ? noPred : P[v];
+            prev = row;
+        }
+    });
+}
+
+// Freeze the graph into compressed sparse row form. Dense indices follow the
+// order of the space ids, and edge weights are the distances between spaces.
+void SpacesGraph::freeze() {
+    ids.assign(V.begin(), V.end());
+    loc.clear();
+    for (std::size_t i = 0; i < ids.size(); ++i)
+        loc[ids[i]] = i;
+
+    astarD.assign(ids.size(), 0);
+    astarP.assign(ids.size(), -1);
+    seen.assign(ids.size(), 0);
+    stamp = 0;
+
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    xs.assign(ids.size(), nan);
+    ys.assign(ids.size(), nan);
+    zs.assign(ids.size(), nan);
+    PointsView points = cl.getPoints();
+    for (Index i = 0; i < cl.size(); ++i) {
+        auto it = loc.find(cl.getIDs()[i]);
+        if (it != loc.end()) {
+            xs[it->second] = points.x[i];
+            ys[it->second] = points.y[i];
+            zs[it->second] = points.z[i];
+        }
+    }
+
+    offsets.assign(1, 0);
+    targets.clear();
+    for (SpaceID u : ids) {
+        std::map<SpaceID, SpaceIDSet>::const_iterator it = E.find(u);
+        if (it != E.end())
+            for (SpaceID v : it->second)
+                targets.push_back(loc[v]);
+        offsets.push_back(targets.size());
+    }
+
+    // The edge weights, from each space to its neighbors at a time
+    weights.resize(targets.size());
+    points = PointsView{xs.data(), ys.data(), zs.data(), ids.size()};
+    for (std::size_t u = 0; u < ids.size(); ++u)
+        manhattanDistances(xs[u], ys[u], zs[u], points, 
+                           targets.data() + offsets[u], 
+                           offsets[u+1] - offsets[u], 
+                           weights.data() + offsets[u]);
+
+    travelMean.resize(weights.size());
+    travelStdev.resize(weights.size());
+    for (std::size_t i = 0; i < weights.size(); ++i) {
+        int d = weights[i];
+        travelMean[i] = 5 * d;
+        travelStdev[i] = d;
+    }
+}
+
+// Build the closure set of the active closures: close the edges into closed 
+// spaces and both directions of closed passages; in all-pairs mode, repair 
+// the rows of the sources whose shortest path tree uses a closed edge (other 
+// rows stay shortest, since closures only remove edges)
+void SpacesGraph::buildClosureSet(
+        const std::vector<Closure>& closures, 
+        const IndexList& active) {
+    closureSets.emplace_back();
+    ClosureSet& cs = closureSets.back();
+    cs.closed.assign(targets.size(), false);
+
+    auto index = [this](SpaceID s) {
+        auto it = loc.find(s);
+        if (it == loc.end()) {
+            std::cerr << "SpacesGraph Error: unknown space " << s 
+                      << " in closures" << std::endl;
+            exitOnError();
+        }
+        return it->second;
+    };
+    std::vector<bool> closedSpace(ids.size(), false);
+    for (Index i : active) {
+        const Closure& c = closures[i];
+        Index u = index(c.sid);
+        if (c.nid == -1) {
+            closedSpace[u] = true;
+            continue;
+        }
+        Index v = index(c.nid);
+        Index e1 = edgeIndex(u,v), e2 = edgeIndex(v,u);
+        if (e1 != -1)
+            cs.closed[e1] = true;
+        if (e2 != -1)
+            cs.closed[e2] = true;
+    }
+    for (std::size_t u = 0; u < ids.size(); ++u) {
+        for (int i = offsets[u]; i < offsets[u+1]; ++i) {
+            if (closedSpace[targets[i]])
+                cs.closed[i] = true;
+            if (cs.closed[i])
+                cs.edges.emplace_back(u, targets[i]);
+        }
+    }
+
+    if (opts.mode != PathMode::AllPairs)
+        return;
+
+    // Find the sources whose shortest path tree uses a closed edge
+    Index n = ids.size();
+    IndexList affected;
+    cs.rowOf.assign(n, -1);
+    for (Index s = 0; s < n; ++s) {
+        for (const std::pair<Index, Index>& e : cs.edges) {
+            if (pred[s*n + e.second] == e.first) {
+                cs.rowOf[s] = affected.size();
+                affected.push_back(s);
                 break;
             }
         }
+    }
 
-        path.push_back(s);
-        if (path.empty())
-            path.push_back(t);
-        else
-            std::reverse(path.begin(), path.end());
-        paths[sd] = path;
+    // The reverse edges (the edges into v are [roffsets[v], roffsets[v+1]) 
+    // of redges, as indices into targets, from the spaces rsources)
+    std::vector<int> roffsets(n+1, 0);
+    for (Index v : targets)
+        ++roffsets[v+1];
+    for (Index v = 0; v < n; ++v)
+        roffsets[v+1] += roffsets[v];
+    std::vector<int> redges(targets.size());
+    IndexList rsources(targets.size());
+    std::vector<int> fill(roffsets.begin(), roffsets.end()-1);
+    for (Index u = 0; u < n; ++u) {
+        for (int i = offsets[u]; i < offsets[u+1]; ++i) {
+            rsources[fill[targets[i]]] = u;
+            redges[fill[targets[i]]++] = i;
+        }
     }
+
+    // Repair their rows: the spaces whose tree path uses a closed edge are 
+    // cut off, and their paths are found again (with Dijkstra's algorithm 
+    // over the cut off spaces) from the spaces whose tree paths are intact
+    cs.rows.resize(affected.size() * n);
+    parallelPaths(affected.size(), [&](Index i, Dist& D, Prev& state) {
+        Index s = affected[i];
+        PredIndex* row = &cs.rows[i * n];
+        std::copy(&pred[s*n], &pred[s*n] + n, row);
+
+        // Distances along the intact tree paths; state is 0 if unknown, 1 if
+        // intact (or unreachable), 2 if cut off
+        const double inf = std::numeric_limits<double>::infinity();
+        D.assign(n, inf);
+        state.assign(n, 0);
+        D[s] = 0;
+        state[s] = 1;
+        IndexList stack;
+        for (Index w = 0; w < n; ++w) {
+            for (Index x = w; state[x] == 0; x = row[x]) {
+                stack.push_back(x);
+                if (row[x] == noPred)
+                    break;
+            }
+            for (; !stack.empty(); stack.pop_back()) {
+                Index y = stack.back();
+                Index p = row[y];
+                Index e = (p == noPred) ? -1 : edgeIndex(p, y);
+                if (p == noPred)
+                    state[y] = 1;
+                else if (state[p] == 2 || cs.closed[e])
+                    state[y] = 2;
+                else {
+                    state[y] = 1;
+                    D[y] = D[p] + weights[e];
+                }
+            }
+        }
+
+        // Reconnect the cut off spaces from the intact spaces
+        typedef std::pair<double, Index> Entry;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> Q;
+        for (Index v = 0; v < n; ++v) {
+            if (state[v] != 2)
+                continue;
+            row[v] = noPred;
+            for (int j = roffsets[v]; j < roffsets[v+1]; ++j) {
+                Index u = rsources[j];
+                double d = D[u] + weights[redges[j]];
+                if (state[u] == 1 && !cs.closed[redges[j]] && d < D[v]) {
+                    D[v] = d;
+                    row[v] = u;
+                }
+            }
+            if (D[v] != inf)
+                Q.push(Entry{D[v], v});
+        }
+        while (!Q.empty()) {
+            Entry x = Q.top();
+            Q.pop();
+            Index u = x.second;
+            if (x.first > D[u]) // already visited with a shorter distance
+                continue;
+            for (int j = offsets[u]; j < offsets[u+1]; ++j) {
+                Index v = targets[j];
+                double d = D[u] + weights[j];
+                if (state[v] == 2 && !cs.closed[j] && d < D[v]) {
+                    D[v] = d;
+                    row[v] = u;
+                    Q.push(Entry{d, v});
+                }
+            }
+        }
+    });
 }
 
-// Dijkstra's algorithm
-std::pair<Dist, Prev> SpacesGraph::dijkstra(SpaceID s) const {
-    Dist D;
-    Prev P;
-    for (SpaceID v : V)
-        D[v] = std::numeric_limits<int>::max();
-    D[s] = 0;
-    SpaceIDSet Q{V};
+// Return the index (as in targets) of the edge from u to v, or -1
+Index SpacesGraph::edgeIndex(Index u, Index v) const {
+    for (int i = offsets[u]; i < offsets[u+1]; ++i)
+        if (targets[i] == v)
+            return i;
+    return -1;
+}
+
+// Use Dijkstra's algorithm to find the shortest paths from the space with 
+// dense index s into row s of the predecessor matrix; D and P are scratch 
+// space.
+void SpacesGraph::cacheShortestPath(Index s, Dist& D, Prev& P) {
+    dijkstra(s, D, P);
+    PredIndex* row = &pred[s * ids.size()];
+    for (Index t = 0; t < (Index) ids.size(); ++t)
+        row[t] = (t == s || P[t] == -1) ? noPred : P[t];
+}
+
+// Dijkstra's algorithm over the frozen graph. Ties are broken by dense index 
+// (i.e., by space id).
+void SpacesGraph::dijkstra(Index s, Dist& D, Prev& P) const 
+{ dijkstraCSR(offsets, targets, weights, s, D, P); }
+
+// A* search between the spaces with dense indices s and t, skipping the 
+// edges closed in the closure set (if not -1); the search stops once t is 
+// settled
+SpaceIDList SpacesGraph::astar(Index s, Index t, Index set) const {
+    const std::vector<bool>* closed = 
+            (set == -1) ? nullptr : &closureSets[set].closed;
+
+    // Start a new search; on wrap around, reset the stamps
+    if (++stamp == 0) {
+        std::fill(seen.begin(), seen.end(), 0);
+        stamp = 1;
+    }
+    seen[s] = stamp;
+    astarD[s] = 0;
+    astarP[s] = -1;
+
+    // Entries are (distance + heuristic, index)
+    typedef std::pair<double, Index> Entry;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> Q;
+    Q.push(Entry{heuristic(s,t), s});
     while (!Q.empty()) {
-        SpaceID u = *std::min_element(Q.begin(), Q.end(),
-                    [&](SpaceID i, SpaceID j){ return D[i] < D[j]; });
-        Q.erase(u);
-        std::map<SpaceID, SpaceIDSet>::const_iterator it = E.find(u);
-        if (it == E.end())
+        Entry x = Q.top();
+        Q.pop();
+        Index u = x.second;
+        if (u == t)
+            break;
+        if (x.first > astarD[u] + heuristic(u,t)) // stale entry
             continue;
-        for (SpaceID v : it->second) {
-            double edgedist = cl.dist(u,v);
-            if (D[u] + edgedist < D[v]) {
-                D[v] = D[u] + edgedist;
-                P[v] = u;
+        for (int i = offsets[u]; i < offsets[u+1]; ++i) {
+            Index v = targets[i];
+            if (closed && (*closed)[i])
+                continue;
+            double d = astarD[u] + weights[i];
+            if (seen[v] != stamp || d < astarD[v]) {
+                seen[v] = stamp;
+                astarD[v] = d;
+                astarP[v] = u;
+                Q.push(Entry{d + heuristic(v,t), v});
+            }
+        }
+    }
+
+    SpaceIDList sl;
+    if (t != s && seen[t] == stamp)
+        for (Index v = t; v != s; v = astarP[v])
+            sl.push_back(ids[v]);
+    sl.push_back(ids[s]);
+    std::reverse(sl.begin(), sl.end());
+    return sl;
+}
+
+// The A* heuristic: the manhattan distance between the spaces with dense 
+// indices u and t (the same as the edge weights, so it never overestimates), 
+// or 0 if either has no coordinates
+double SpacesGraph::heuristic(Index u, Index t) const {
+    double h = fabs(xs[u] - xs[t]) + fabs(ys[u] - ys[t]) + fabs(zs[u] - zs[t]);
+    return std::isnan(h) ? 0 : h;
+}
+
+// Build the hierarchical routing tables: partition the spaces into clusters, 
+// find all paths within each cluster (one cluster per task), then all paths 
+// between boundary spaces over the overlay graph (one source per task)
+void SpacesGraph::buildHierarchy() {
+    const double inf = std::numeric_limits<double>::infinity();
+    Index n = ids.size();
+
+    // Partition the spaces by cluster attribute, or else by floor and cell
+    std::map<SpaceID, ClusterID> attr;
+    for (const Space& c : cl)
+        attr[c.id] = c.cluster;
+    typedef std::tuple<int, ClusterID, double, long, long> Key;
+    std::map<Key, Index> keys;
+    clusters.clear();
+    clusterOf.assign(n, -1);
+    localOf.assign(n, -1);
+    for (Index u = 0; u < n; ++u) {
+        double size = opts.clusterSize;
+        Key key;
+        if (attr.count(ids[u]) && attr[ids[u]] != -1)
+            key = Key{0, attr[ids[u]], 0, 0, 0};
+        else if (std::isnan(xs[u]))
+            key = Key{2, 0, 0, 0, 0};
+        else
+            key = Key{1, 0, zs[u], size > 0 ? (long) floor(xs[u] / size) : 0, 
+                      size > 0 ? (long) floor(ys[u] / size) : 0};
+
+        auto it = keys.find(key);
+        if (it == keys.end()) {
+            it = keys.emplace(key, clusters.size()).first;
+            clusters.emplace_back();
+        }
+        Cluster& c = clusters[it->second];
+        clusterOf[u] = it->second;
+        localOf[u] = c.members.size();
+        c.members.push_back(u);
+        if (c.members.size() >= noPred) {
+            std::cerr << "SpacesGraph Error: a cluster has too many spaces; " 
+                      << "at most " << noPred-1 << " are supported" 
+                      << std::endl;
+            exitOnError();
+        }
+    }
+
+    // Boundary spaces have an edge to or from another cluster
+    std::vector<bool> isBoundary(n, false);
+    for (Index u = 0; u < n; ++u)
+        for (int i = offsets[u]; i < offsets[u+1]; ++i)
+            if (clusterOf[u] != clusterOf[targets[i]])
+                isBoundary[u] = isBoundary[targets[i]] = true;
+    overlayOf.assign(n, -1);
+    overlayIds.clear();
+    for (Cluster& c : clusters) {
+        for (std::size_t l = 0; l < c.members.size(); ++l) {
+            if (isBoundary[c.members[l]]) {
+                c.boundary.push_back(l);
+                overlayOf[c.members[l]] = overlayIds.size();
+                overlayIds.push_back(c.members[l]);
+            }
+        }
+    }
+    if (overlayIds.size() >= noPred) {
+        std::cerr << "SpacesGraph Error: too many boundary spaces (" 
+                  << overlayIds.size() << "); at most " << noPred-1 
+                  << " are supported (use larger clusters)" << std::endl;
+        exitOnError();
+    }
+
+    // Paths within each cluster, over the edges within the cluster
+    parallelPaths(clusters.size(), [this](Index ci, Dist& D, Prev& P) {
+        Cluster& c = clusters[ci];
+        Index m = c.members.size();
+        std::vector<int> coffsets{0};
+        std::vector<Index> ctargets;
+        std::vector<double> cweights;
+        for (Index u : c.members) {
+            for (int i = offsets[u]; i < offsets[u+1]; ++i) {
+                if (clusterOf[targets[i]] == ci) {
+                    ctargets.push_back(localOf[targets[i]]);
+                    cweights.push_back(weights[i]);
+                }
+            }
+            coffsets.push_back(ctargets.size());
+        }
+
+        c.dist.resize(m * m);
+        c.pred.resize(m * m);
+        for (Index s = 0; s < m; ++s) {
+            dijkstraCSR(coffsets, ctargets, cweights, s, D, P);
+            for (Index t = 0; t < m; ++t) {
+                c.dist[s*m + t] = D[t];
+                c.pred[s*m + t] = (t == s || P[t] == -1) ? noPred : P[t];
+            }
+        }
+    });
+
+    // The overlay graph: edges between clusters, and shortcuts between the 
+    // boundary spaces of each cluster
+    Index B = overlayIds.size();
+    std::vector<int> ooffsets{0};
+    std::vector<Index> otargets;
+    std::vector<double> oweights;
+    for (Index u : overlayIds) {
+        for (int i = offsets[u]; i < offsets[u+1]; ++i) {
+            if (clusterOf[u] != clusterOf[targets[i]]) {
+                otargets.push_back(overlayOf[targets[i]]);
+                oweights.push_back(weights[i]);
+            }
+        }
+        const Cluster& c = clusters[clusterOf[u]];
+        Index m = c.members.size();
+        for (Index l : c.boundary) {
+            double d = c.dist[localOf[u]*m + l];
+            if (l != localOf[u] && d != inf) {
+                otargets.push_back(overlayOf[c.members[l]]);
+                oweights.push_back(d);
             }
         }
+        ooffsets.push_back(otargets.size());
+    }
+
+    // Paths between all boundary spaces
+    odist.resize(B * B);
+    opred.resize(B * B);
+    parallelPaths(B, [&](Index s, Dist& D, Prev& P) {
+        dijkstraCSR(ooffsets, otargets, oweights, s, D, P);
+        for (Index t = 0; t < B; ++t) {
+            odist[s*B + t] = D[t];
+            opred[s*B + t] = (t == s || P[t] == -1) ? noPred : P[t];
+        }
+    });
+}
+
+// Return the shortest path between the spaces with dense indices s and t from
+// the hierarchical tables: either within their cluster, or from s to a 
+// boundary space of its cluster, over the overlay graph to a boundary space 
+// of the cluster of t, then to t
+SpaceIDList SpacesGraph::hierarchicalPath(Index s, Index t) const {
+    SpaceIDList sl{ids[s]};
+    if (s == t)
+        return sl;
+
+    const double inf = std::numeric_limits<double>::infinity();
+    Index cs = clusterOf[s], ct = clusterOf[t];
+    const Cluster& S = clusters[cs];
+    const Cluster& T = clusters[ct];
+    Index ls = localOf[s], lt = localOf[t];
+    Index ms = S.members.size(), mt = T.members.size();
+    Index B = overlayIds.size();
+
+    // The best path, through the boundary spaces bs and bt (local indices), 
+    // or within the cluster if bs is -1
+    double best = (cs == ct) ? S.dist[ls*ms + lt] : inf;
+    Index bs = -1, bt = -1;
+    for (Index x : S.boundary) {
+        double d1 = S.dist[ls*ms + x];
+        if (d1 == inf)
+            continue;
+        const double* row = &odist[overlayOf[S.members[x]] * B];
+        for (Index y : T.boundary) {
+            double d = d1 + row[overlayOf[T.members[y]]] + T.dist[y*mt + lt];
+            if (d < best) {
+                best = d;
+                bs = x;
+                bt = y;
+            }
+        }
+    }
+
+    if (best == inf)
+        return sl;
+    if (bs == -1) {
+        appendClusterPath(cs, ls, lt, sl);
+        return sl;
+    }
+    appendClusterPath(cs, ls, bs, sl);
+    appendOverlayPath(overlayOf[S.members[bs]], overlayOf[T.members[bt]], sl);
+    appendClusterPath(ct, bt, lt, sl);
+    return sl;
+}
+
+// Append the path within cluster c from local index a to b (excluding a)
+void SpacesGraph::appendClusterPath(
+        Index c, 
+        Index a, 
+        Index b, 
+        SpaceIDList& sl) const {
+    const Cluster& C = clusters[c];
+    const PredIndex* row = &C.pred[a * C.members.size()];
+    std::size_t start = sl.size();
+    for (Index v = b; v != a && row[v] != noPred; v = row[v])
+        sl.push_back(ids[C.members[v]]);
+    std::reverse(sl.begin() + start, sl.end());
+}
+
+// Append the path over the overlay graph from overlay index a to b (excluding 
+// a), expanding shortcuts into paths within their cluster
+void SpacesGraph::appendOverlayPath(Index a, Index b, SpaceIDList& sl) const {
+    const PredIndex* row = &opred[a * overlayIds.size()];
+    IndexList hops;
+    for (Index v = b; v != a && row[v] != noPred; v = row[v])
+        hops.push_back(v);
+    Index u = overlayIds[a];
+    for (auto it = hops.rbegin(); it != hops.rend(); ++it) {
+        Index v = overlayIds[*it];
+        if (clusterOf[u] == clusterOf[v])
+            appendClusterPath(clusterOf[u], localOf[u], localOf[v], sl);
+        else
+            sl.push_back(ids[v]);
+        u = v;
     }
-    return std::make_pair(D,P);
 }
 
 // Breadth first search
-std::pair<Dist, Prev> SpacesGraph::bfs(SpaceID s) const {
+void SpacesGraph::bfs(Index s, Dist& D, Prev& P) const {
     // Mark all vertices as not visited
-    Prev P;
-    Dist D;
-    for (SpaceID v : V)
-        D[v] = -1;
+    D.assign(ids.size(), -1);
+    P.assign(ids.size(), -1);
 
     // Create a queue for BFS; mark current node and pushback to queue
     D[s] = 0;
-    SpaceIDList queue{s};
+    std::vector<Index> queue{s};
 
-    while (!queue.empty()) {
-        // Dequeue vertex from queue and print it
-        SpaceID u = queue.front();
-        queue.erase(queue.begin());
+    for (std::size_t head = 0; head < queue.size(); ++head) {
+        // Dequeue vertex from queue
+        Index u = queue[head];
 
         // Get all adj vertices of curr; mark unvisited vertices and enqueue
-        std::map<SpaceID, SpaceIDSet>::const_iterator it = E.find(u);
-        if (it == E.end())
-            continue;
-        for (SpaceID v : it->second) {
+        for (int i = offsets[u]; i < offsets[u+1]; ++i) {
+            Index v = targets[i];
             if (D[v] == -1) {
                 D[v] = D[u] + 1;
                 P[v] = u;
@@ -258,48 +1178,249 @@ std::pair<Dist, Prev> SpacesGraph::bfs(SpaceID s) const {
             }
         }
     }
-    return std::make_pair(D,P);
 }
 
-// Read the fcache file and load in the cached paths
+// Return a hash (64-bit FNV-1a) of the frozen graph
+std::uint64_t SpacesGraph::fingerprint() const {
+    std::uint64_t h = 14695981039346656037ull;
+    auto hash = [&h](const void* data, std::size_t size) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < size; ++i) {
+            h ^= p[i];
+            h *= 1099511628211ull;
+        }
+    };
+    hash(ids.data(), ids.size() * sizeof(SpaceID));
+    hash(offsets.data(), offsets.size() * sizeof(int));
+    hash(targets.data(), targets.size() * sizeof(Index));
+    hash(weights.data(), weights.size() * sizeof(double));
+    return h;
+}
+
+// Map the fcache file and load in the cached predecessor matrix. A cache of 
+// another graph is updated to the current graph (and rewritten); a cache in 
+// another format is rejected.
 bool SpacesGraph::loadSpacesCache() {
-    if (!checkFileExists(fcache))
+    if (fcache == "" || fcache == "none" || !checkFileExists(fcache))
         return false;
     std::cout << "reading cache file" << std::endl;
-    std::string src,dest,path;
-    for (std::ifstream file{fcache}; std::getline(file, src, ',');) {
-        std::getline(file, dest, ',');
-        SrcDest sd{std::stoi(src), std::stoi(dest)};
-
-        std::getline(file, path);
-        char cline[path.length()+1];
-        std::strcpy(cline, path.c_str());
-        char* tok = std::strtok(cline, ";");
-        SpaceIDList sl;
-        while (tok) {
-            sl.push_back(std::atoi(tok));
-            tok = std::strtok(NULL, ";");
-        }
-        paths[sd] = sl;
+
+    MappedFile file{fcache};
+    PathCacheHeader h;
+    if (file.size() < sizeof h) {
+        std::cout << "cache file is stale; recomputing paths" << std::endl;
+        return false;
+    }
+    std::memcpy(&h, file.data(), sizeof h);
+    std::size_t n = h.n, m = h.m;
+    std::size_t size = sizeof h + 
+                       (2*n + 1 + m) * sizeof(std::int32_t) + 
+                       m * sizeof(double) + 
+                       n * n * sizeof(PredIndex);
+    if (std::memcmp(h.magic, pathCacheMagic, sizeof h.magic) != 0 || 
+            h.version != pathCacheVersion || 
+            file.size() != size) {
+        std::cout << "cache file is stale; recomputing paths" << std::endl;
+        return false;
+    }
+
+    if (h.fingerprint != fingerprint() || h.n != ids.size()) {
+        updateSpacesCache(file, h);
+        writeSpacesCache();
+        return true;
     }
+    std::size_t bytes = pred.size() * sizeof(PredIndex);
+    std::memcpy(pred.data(), file.data() + size - bytes, bytes);
     return true;
 }
 
-// Save the computed paths into fcache
+// Update the predecessor matrix cached for another (e.g., previous) graph to 
+// the current graph. The spaces are matched by id, and the edges by their 
+// spaces; edges that are new or shorter are "closer", and edges that are 
+// removed or longer are "farther". The tree of each source is walked with 
+// the current weights: the spaces whose tree path uses a farther edge are cut 
+// off, and the spaces whose tree path uses a closer edge get closer. Then 
+// only if some space got closer or was cut off, or a closer edge shortens a 
+// path, is the row repaired, by relaxing edges (as in Dijkstra's algorithm) 
+// from those spaces; paths of new sources are found from scratch. Repaired 
+// paths are shortest, but equal paths may be chosen differently than by a 
+// full computation.
+void SpacesGraph::updateSpacesCache(
+        const MappedFile& file, 
+        const PathCacheHeader& h) {
+    // Read the previous graph
+    Index on = h.n, om = h.m;
+    std::vector<std::int32_t> oids(on), ooffsets(on+1), otargets(om);
+    std::vector<double> oweights(om);
+    const char* at = file.data() + sizeof h;
+    auto read = [&at](void* data, std::size_t bytes) {
+        std::memcpy(data, at, bytes);
+        at += bytes;
+    };
+    read(oids.data(), on * sizeof(std::int32_t));
+    read(ooffsets.data(), (on+1) * sizeof(std::int32_t));
+    read(otargets.data(), om * sizeof(std::int32_t));
+    read(oweights.data(), om * sizeof(double));
+    const char* opred = at;
+
+    // Match the spaces (by id) and the edges (by their spaces) of both graphs
+    Index n = ids.size();
+    IndexList oldOf(n, -1), newOf(on, -1);
+    for (Index i = 0; i < on; ++i) {
+        auto it = loc.find(oids[i]);
+        if (it != loc.end()) {
+            newOf[i] = it->second;
+            oldOf[it->second] = i;
+        }
+    }
+    enum : char { same, closer, farther };
+    std::vector<char> change(targets.size(), closer);
+    for (Index u = 0; u < n; ++u) {
+        Index ou = oldOf[u];
+        if (ou == -1)
+            continue;
+        for (int i = offsets[u]; i < offsets[u+1]; ++i) {
+            Index ov = oldOf[targets[i]];
+            for (int j = ooffsets[ou]; j < ooffsets[ou+1]; ++j) {
+                if (otargets[j] != ov)
+                    continue;
+                change[i] = weights[i] < oweights[j] ? closer : 
+                            weights[i] > oweights[j] ? farther : same;
+                break;
+            }
+        }
+    }
+
+    std::atomic<Index> repaired{0};
+    parallelPaths(n, [&](Index s, Dist& D, Prev& state) {
+        Index os = oldOf[s];
+        if (os == -1) {
+            cacheShortestPath(s, D, state);
+            ++repaired;
+            return;
+        }
+
+        // Translate the previous row; state is 0 if unknown, 1 if intact (or 
+        // unreachable), 2 if cut off, 3 if closer
+        const double inf = std::numeric_limits<double>::infinity();
+        PredIndex* row = &pred[s * n];
+        const char* orow = opred + os * on * sizeof(PredIndex);
+        D.assign(n, inf);
+        state.assign(n, 0);
+        for (Index v = 0; v < n; ++v) {
+            PredIndex op = noPred;
+            if (oldOf[v] != -1)
+                std::memcpy(&op, orow + oldOf[v]*sizeof(PredIndex), sizeof op);
+            row[v] = (op == noPred || newOf[op] == -1) ? noPred : newOf[op];
+            if (oldOf[v] == -1)
+                state[v] = 1;
+            else if (op != noPred && newOf[op] == -1)
+                state[v] = 2;
+        }
+        D[s] = 0;
+        state[s] = 1;
+
+        // Distances along the tree paths, with the current weights
+        bool dirty = false;
+        IndexList stack;
+        for (Index w = 0; w < n; ++w) {
+            for (Index x = w; state[x] == 0; x = row[x]) {
+                stack.push_back(x);
+                if (row[x] == noPred)
+                    break;
+            }
+            for (; !stack.empty(); stack.pop_back()) {
+                Index y = stack.back();
+                Index p = row[y];
+                Index e = (p == noPred) ? -1 : edgeIndex(p, y);
+                if (p == noPred)
+                    state[y] = 1;
+                else if (e == -1 || state[p] == 2 || change[e] == farther)
+                    state[y] = 2;
+                else {
+                    D[y] = D[p] + weights[e];
+                    state[y] = (state[p] == 3 || change[e] == closer) ? 3 : 1;
+                }
+                dirty = dirty || state[y] >= 2;
+            }
+        }
+        for (Index v = 0; v < n; ++v)
+            if (state[v] == 2)
+                row[v] = noPred;
+
+        // Relax the edges out of the spaces that got closer, and of the 
+        // spaces with a closer edge (or an edge into a cut off space) that 
+        // shortens a path
+        typedef std::pair<double, Index> Entry;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> Q;
+        for (Index u = 0; u < n; ++u) {
+            if (state[u] == 2 || D[u] == inf)
+                continue;
+            bool push = (state[u] == 3);
+            for (int i = offsets[u]; i < offsets[u+1] && !push; ++i) {
+                Index v = targets[i];
+                push = (change[i] == closer || state[v] == 2) && 
+                       D[u] + weights[i] < D[v];
+            }
+            if (push)
+                Q.push(Entry{D[u], u});
+        }
+        dirty = dirty || !Q.empty();
+        while (!Q.empty()) {
+            Entry x = Q.top();
+            Q.pop();
+            Index u = x.second;
+            if (x.first > D[u]) // already visited with a shorter distance
+                continue;
+            for (int i = offsets[u]; i < offsets[u+1]; ++i) {
+                Index v = targets[i];
+                double d = D[u] + weights[i];
+                if (d < D[v]) {
+                    D[v] = d;
+                    row[v] = u;
+                    Q.push(Entry{d, v});
+                }
+            }
+        }
+        if (dirty)
+            ++repaired;
+    });
+
+    std::cout << "cache file is of another graph; repaired the paths of "
+              << repaired << " of " << n << " sources" << std::endl;
+}
+
+// Save the frozen graph and the predecessor matrix into fcache (through a 
+// temporary file, so that an interrupted write does not leave a truncated 
+// cache)
 void SpacesGraph::writeSpacesCache() {
-    if (fcache == "")
+    if (fcache == "" || fcache == "none")
         return;
-    std::ofstream file(fcache);
-    for (const std::pair<SrcDest, SpaceIDList>& e : paths) {
-        file << e.first.first << "," << e.first.second << ",";
 
-        if (!e.second.empty()) {
-            SpaceIDList::const_iterator it = e.second.begin();
-            file << *it++;
-            for (; it != e.second.end(); ++it)
-                file << ";" << *it;
-        }
-        file << "\n";
+    PathCacheHeader h;
+    std::memcpy(h.magic, pathCacheMagic, sizeof h.magic);
+    h.version = pathCacheVersion;
+    h.n = ids.size();
+    h.m = targets.size();
+    h.reserved = 0;
+    h.fingerprint = fingerprint();
+
+    Filename tmp = fcache + ".tmp";
+    std::ofstream file(tmp, std::ios::binary);
+    auto write = [&file](const void* data, std::size_t bytes) {
+        file.write(static_cast<const char*>(data), bytes);
+    };
+    write(&h, sizeof h);
+    write(ids.data(), ids.size() * sizeof(SpaceID));
+    write(offsets.data(), offsets.size() * sizeof(int));
+    write(targets.data(), targets.size() * sizeof(Index));
+    write(weights.data(), weights.size() * sizeof(double));
+    write(pred.data(), pred.size() * sizeof(PredIndex));
+    file.close();
+    if (!file || std::rename(tmp.c_str(), fcache.c_str()) != 0) {
+        std::cerr << "SpacesGraph Warning: cannot write cache file "
+                  << fcache << std::endl;
+        std::remove(tmp.c_str());
     }
 }
 
@@ -6,9 +6,14 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <mutex>
+#include <thread>
+#include <streambuf>
 #include <utility>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 
 #include "../include/rapidjson/document.h"
 #include "../include/rapidjson/filereadstream.h"
@@ -17,6 +22,105 @@
 
 #include "Typedefs.hpp"
 
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// Errors
+
+// Thrown by exitOnError() in place of exiting, while the exit is deferred
+struct DeferredExit {};
+
+namespace {
+
+    // Whether exitOnError() is deferred on this thread (see catchExit())
+    thread_local bool deferExit = false;
+
+}
+
+// Exit after an error (once it is printed to std::cerr), or throw 
+// DeferredExit while the exit is deferred on this thread
+[[noreturn]] void exitOnError() {
+    if (deferExit)
+        throw DeferredExit{};
+    std::exit(1);
+}
+
+// Run f, deferring any exit on an error to the caller (e.g., on a worker 
+// thread, so that the process exits from the main thread, once the others 
+// have finished). Return false if f exited on an error.
+template <class F>
+bool catchExit(const F& f) {
+    deferExit = true;
+    try {
+        f();
+    }
+    catch (const DeferredExit&) {
+        deferExit = false;
+        return false;
+    }
+    deferExit = false;
+    return true;
+}
+
+// Collects the output to a stream from each thread, in place of its buffer, 
+// and writes the output of a thread in one piece on flush(), so that the 
+// output of concurrent tasks is not interleaved. The buffer of the stream is 
+// restored on destruction.
+class ThreadOutput : public std::streambuf {
+public:
+    explicit ThreadOutput(std::ostream& os);
+    ~ThreadOutput();
+
+    void flush();
+
+protected:
+    int overflow(int c) override;
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+
+private:
+    std::ostream& os;
+    std::streambuf* orig;
+
+    // The output of each thread, since it was last flushed
+    std::map<std::thread::id, std::string> pending;
+    std::mutex m;
+};
+
+// Replace the buffer of the stream
+ThreadOutput::ThreadOutput(std::ostream& os) : os{os}, orig{os.rdbuf(this)} {}
+
+// Write the remaining output, and restore the buffer of the stream
+ThreadOutput::~ThreadOutput() {
+    for (const std::pair<const std::thread::id, std::string>& p : pending)
+        orig->sputn(p.second.data(), p.second.size());
+    orig->pubsync();
+    os.rdbuf(orig);
+}
+
+// Write the output of this thread
+void ThreadOutput::flush() {
+    std::lock_guard<std::mutex> lock{m};
+    std::string& s = pending[std::this_thread::get_id()];
+    orig->sputn(s.data(), s.size());
+    orig->pubsync();
+    s.clear();
+}
+
+// Collect a character of output
+int ThreadOutput::overflow(int c) {
+    if (c != traits_type::eof()) {
+        std::lock_guard<std::mutex> lock{m};
+        pending[std::this_thread::get_id()] += traits_type::to_char_type(c);
+    }
+    return traits_type::not_eof(c);
+}
+
+// Collect n characters of output
+std::streamsize ThreadOutput::xsputn(const char* s, std::streamsize n) {
+    std::lock_guard<std::mutex> lock{m};
+    pending[std::this_thread::get_id()].append(s, n);
+    return n;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 // File IO
@@ -27,6 +131,65 @@ bool checkFileExists(const Filename& fname) {
     return stat(fname.c_str(), &buf) == 0;
 }
 
+// A read-only memory mapping of a whole file. It is empty (size 0) if the 
+// file cannot be mapped.
+class MappedFile {
+public:
+    explicit MappedFile(const Filename& fname);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return static_cast<const char*>(addr); }
+    std::size_t size() const { return len; }
+
+private:
+    void* addr = nullptr;
+    std::size_t len = 0;
+};
+
+// Map the file into memory
+MappedFile::MappedFile(const Filename& fname) {
+    int fd = open(fname.c_str(), O_RDONLY);
+    if (fd == -1)
+        return;
+    struct stat buf;
+    if (fstat(fd, &buf) == 0 && buf.st_size > 0) {
+        void* p = mmap(nullptr, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            addr = p;
+            len = buf.st_size;
+        }
+    }
+    close(fd);
+}
+
+// Unmap the file
+MappedFile::~MappedFile() {
+    if (addr)
+        munmap(addr, len);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// String Utils
+
+// Parses a comma separated list of ints, e.g., "1, 2, 3"
+std::vector<int> parseIntList(const std::string& s) {
+    std::vector<int> arr;
+    std::string::size_type i = 0;
+    while (i < s.size()) {
+        std::string::size_type j = s.find(',', i);
+        if (j == std::string::npos)
+            j = s.size();
+        if (s.find_first_not_of(" \t", i) < j)
+            arr.push_back(std::stoi(s.substr(i, j-i)));
+        i = j+1;
+    }
+    return arr;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 // JSON IO Utils
@@ -45,7 +208,7 @@ void openJSON(const Filename& fname, rj::Document& d) {
     FILE* fp = fopen(fname.c_str(), "rb");
     if (fp == NULL) {
         std::cerr << "Invalid file " << fname << std::endl;
-        std::exit(1);
+        exitOnError();
     }
 
     char buf[BUF];
@@ -59,7 +222,7 @@ void dumpJSON(const Filename& fname, rj::Document& d) {
     FILE* fp = fopen(fname.c_str(), "wb");
     if (fp == NULL) {
         std::cerr << "Invalid file " << fname << std::endl;
-        std::exit(1);
+        exitOnError();
     }
 
     char buf[BUF];
@@ -75,7 +238,7 @@ int parseInt(const rj::Value& v, const char* m) {
         return v[m].GetInt();
 
     std::cerr << "JSON object cannot parse int for " << m << std::endl;
-    std::exit(1);
+    exitOnError();
 }
 
 // Parses an int from the rapidjson value, or returns the default option
@@ -88,7 +251,7 @@ double parseDouble(const rj::Value& v, const char* m) {
         return v[m].GetDouble();
 
     std::cerr << "JSON object cannot parse double for " << m << std::endl;
-    std::exit(1);
+    exitOnError();
 }
 
 // Parses a double from the rapidjson value, or returns the default option
@@ -101,7 +264,7 @@ std::string parseStr(const rj::Value& v, const char* m) {
         return v[m].GetString();
 
     std::cerr << "JSON object cannot parse string for " << m << std::endl;
-    std::exit(1);
+    exitOnError();
 }
 
 // Parses a string from the rapidjson value, or returns the default option
@@ -121,7 +284,7 @@ std::vector<int> parseIntArr(const rj::Value& v, const char* m) {
     }
 
     std::cerr << "JSON object cannot parse int array for " << m << std::endl;
-    std::exit(1);
+    exitOnError();
 }
 
 // Parses a double array from the rapidjson value
@@ -137,7 +300,7 @@ std::vector<double> parseDoubleArr(const rj::Value& v, const char* m) {
     }
 
     std::cerr << "JSON object cannot parse double array " << m << std::endl;
-    std::exit(1);
+    exitOnError();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -5,13 +5,138 @@
 #include <string>
 #include <chrono>
 #include <random>
+#include <vector>
 #include <cmath>
+#include <cstdint>
 
 #include "../include/date/date.h"
 
 #include "DateUtils.hpp"
 #include "RandomGenerator.hpp"
 
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// Standard Normal
+namespace {
+
+    // Number of standard normal samples generated at a time
+    const int NORMAL_BLOCK = 1024;
+
+    // Ziggurat with 128 layers: the start of the tail, and the area of a layer
+    const int    ZIG_C = 128;
+    const double ZIG_R = 3.442619855899;
+    const double ZIG_V = 9.91256303526217e-3;
+
+} // end namespace
+
+// Samples the standard normal distribution with the ziggurat method (Marsaglia
+// and Tsang, 2000). Most samples take one 64-bit random number, a table 
+// lookup and a multiplication.
+class Ziggurat {
+public:
+
+    // Constructor
+    Ziggurat();
+
+    // Modifiers
+    void fill(double* out, int n);
+
+private:
+
+    // Return a uniform sample in (0,1]
+    double uniform();
+
+    // Return a standard normal sample
+    double sample();
+
+    // Edges of the layers, and the ratio of the edges of consecutive layers
+    double x[ZIG_C+1], r[ZIG_C];
+
+    // A 64-bit random engine, seeded from the default random engine
+    std::mt19937_64 engine;
+
+};
+
+// Compute the layers of the ziggurat
+Ziggurat::Ziggurat() 
+    : engine{((uint64_t) generator()() << 32) ^ generator()()} {
+    double f = std::exp(-0.5 * ZIG_R * ZIG_R);
+    x[0] = ZIG_V / f; // bottom layer (includes the tail)
+    x[1] = ZIG_R;
+    x[ZIG_C] = 0;
+    for (int i = 2; i < ZIG_C; ++i) {
+        x[i] = std::sqrt(-2 * std::log(ZIG_V / x[i-1] + f));
+        f = std::exp(-0.5 * x[i] * x[i]);
+    }
+    for (int i = 0; i < ZIG_C; ++i)
+        r[i] = x[i+1] / x[i];
+}
+
+// Fill out[0..n) with standard normal samples
+void Ziggurat::fill(double* out, int n) {
+    for (int i = 0; i < n; ++i)
+        out[i] = sample();
+}
+
+// Return a uniform sample in (0,1]
+double Ziggurat::uniform() { return ((engine() >> 11) + 1) * 0x1.0p-53; }
+
+// Return a standard normal sample
+double Ziggurat::sample() {
+    for (;;) {
+        // The low 7 bits select the layer; the high 52 bits give a uniform 
+        // sample in [-1,1)
+        uint64_t b = engine();
+        int i = b & 0x7F;
+        double u = (b >> 12) * 0x1.0p-51 - 1.0;
+
+        // Inside the rectangular part of the layer
+        if (std::fabs(u) < r[i])
+            return u * x[i];
+
+        // In the tail
+        if (i == 0) {
+            double tx, ty;
+            do {
+                tx = std::log(uniform()) / ZIG_R;
+                ty = std::log(uniform());
+            } while (-2 * ty < tx * tx);
+            return u < 0 ? tx - ZIG_R : ZIG_R - tx;
+        }
+
+        // In the wedge of the layer
+        double v = u * x[i];
+        double f0 = std::exp(-0.5 * (x[i] * x[i] - v * v));
+        double f1 = std::exp(-0.5 * (x[i+1] * x[i+1] - v * v));
+        if (f1 + uniform() * (f0 - f1) < 1.0)
+            return v;
+    }
+}
+
+// Returns the static ziggurat for sampling the standard normal distribution
+Ziggurat& ziggurat() {
+    static Ziggurat zig;
+    return zig;
+}
+
+// Return a sample of the standard normal distribution. Samples are drawn from
+// a block that is refilled once exhausted. Like generator(), the block and 
+// the ziggurat are not synchronized: sampling is single-threaded by contract 
+// (the thread pools of the data loader and the spaces graph never sample).
+double standardNormal() {
+    static double block[NORMAL_BLOCK];
+    static int pos = NORMAL_BLOCK;
+    if (pos == NORMAL_BLOCK) {
+        ziggurat().fill(block, NORMAL_BLOCK);
+        pos = 0;
+    }
+    return block[pos++];
+}
+
+// Fill the list with samples of the standard normal distribution
+void standardNormals(std::vector<double>& out) 
+{ ziggurat().fill(out.data(), out.size()); }
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 // Normal
@@ -35,26 +160,27 @@ public:
 
 private:
 
-    // The normal distribution 
-    std::normal_distribution<double> distr;
+    // The mean and standard deviation of the distribution
+    double mu, sigma;
 
 };
 
 // Constructor
 template<class T>
-Normal<T>::Normal(double mean, double stdev) : distr(mean, stdev) {}
+Normal<T>::Normal(double mean, double stdev) : mu{mean}, sigma{stdev} {}
 
 // Return the mean of the normal distribution
 template<class T>
-double Normal<T>::mean() const { return distr.mean(); }
+double Normal<T>::mean() const { return mu; }
 
 // Return the standard deviation of the normal distribution
 template<class T>
-double Normal<T>::stdev() const { return distr.stddev(); }
+double Normal<T>::stdev() const { return sigma; }
 
 // Returns a value obtained by sampling the distribution
 template<class T>
-T Normal<T>::sample() { return distr(generator()); }
+T Normal<T>::sample() 
+{ return sigma == 0 ? mu : mu + sigma * standardNormal(); }
 
 // Print the normal distribution
 template<class T>
@@ -81,6 +207,7 @@ public:
     Time stdev() const;
 
     Time sample();
+    void sample(TimeList& out);
     
     // I/O
     friend std::ostream& operator<<(std::ostream& oss, const NormalTime& n);
@@ -123,6 +250,16 @@ Time NormalTime::stdev() const { return stdevTime; }
 Time NormalTime::sample() 
 { return Time{meanTime + std::chrono::seconds{(int) (timeStdev.sample())}}; }
 
+// Fill the list with values obtained by sampling the distribution
+void NormalTime::sample(TimeList& out) {
+    std::vector<double> z(out.size());
+    standardNormals(z);
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        int d = timeStdev.stdev() * z[i];
+        out[i] = Time{meanTime + std::chrono::seconds{d}};
+    }
+}
+
 // Print the normal distribution of times
 std::ostream& operator<<(std::ostream& oss, const NormalTime& n) {
     oss << "N(" << n.mean() << "+/-" << n.stdev() << ")";
@@ -12,6 +12,7 @@
 #include "Typedefs.hpp"
 #include "IOUtils.hpp"
 #include "RandomGenerator.hpp"
+#include "Snapshot.hpp"
 
 template <class T>
 class RandomSelector {
@@ -33,6 +34,8 @@ public:
     std::vector<T> selectWeightedN(int n, bool replace=false);
 
     // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     template <class T2>
     friend std::ostream& operator<<(
             std::ostream& oss, 
@@ -109,7 +112,7 @@ std::vector<T> RandomSelector<T>::selectRandomN(int n, bool replace) {
         if (n > vec.size()) {
             std::cerr << "RandomSelector Error: " 
                       << vec.size() << "C" << n << std::endl;
-            std::exit(1);
+            exitOnError();
         }
 
         std::vector<int> idx(vec.size());
@@ -138,7 +141,7 @@ std::vector<T> RandomSelector<T>::selectWeightedN(int n, bool replace) {
         if (n > vec.size()) {
             std::cerr << "RandomSelector Error: "
                       << vec.size() << "C" << n << std::endl;
-            std::exit(1);
+            exitOnError();
         }
 
         std::vector<T> ret(n);
@@ -156,6 +159,16 @@ std::vector<T> RandomSelector<T>::selectWeightedN(int n, bool replace) {
     }
 }
 
+// Write the random selector into the snapshot
+template <class T>
+void RandomSelector<T>::save(SnapshotWriter& w) const 
+{ w.put(vec, prs); }
+
+// Read the random selector from the snapshot
+template <class T>
+void RandomSelector<T>::load(SnapshotReader& r) 
+{ r.get(vec, prs); }
+
 // Print the vector of values and corresponding probabilities
 template <class T>
 std::ostream& operator<<(std::ostream& oss, const RandomSelector<T>& rs) {
@@ -187,6 +200,8 @@ public:
     SpaceIDList select();
 
     // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     friend std::ostream& operator<<(std::ostream& oss, const SpaceSelector& s);
 
 private:
@@ -217,6 +232,14 @@ SpaceSelector::SpaceSelector(const rj::Value& v, int n)
 // Select n random spaces
 SpaceIDList SpaceSelector::select() { return sel.selectRandomN(n); }
 
+// Write the space selector into the snapshot
+void SpaceSelector::save(SnapshotWriter& w) const 
+{ w.put(sel, n); }
+
+// Read the space selector from the snapshot
+void SpaceSelector::load(SnapshotReader& r) 
+{ r.get(sel, n); }
+
 // Print the vector of spaces to select from, and how many to select
 std::ostream& operator<<(std::ostream& oss, const SpaceSelector& s) {
     oss << "SpaceSelector(" << s.sel.getVec() << ", n=" << s.n << ")";
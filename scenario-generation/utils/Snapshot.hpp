@@ -0,0 +1,423 @@
+#ifndef UTILS_SNAPSHOT_HPP
+#define UTILS_SNAPSHOT_HPP
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <type_traits>
+
+#include "Typedefs.hpp"
+#include "IOUtils.hpp"
+
+// A binary snapshot of a scenario (see DataLoader) starts with this header, 
+// and is followed by the loaders, each written by its save() method
+struct SnapshotHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t reserved;
+    std::uint64_t inputs;   // hash of the input files, except the entities
+    std::uint64_t entities; // hash of the events and people files
+    std::uint64_t size;     // size of the whole snapshot
+};
+
+const char snapshotMagic[8] = {'S','S','S','N','A','P','S','\0'};
+const std::uint32_t snapshotVersion = 1;
+
+// Return a hash (FNV-1a) of the contents of the file, or of the filename if 
+// the file cannot be read (e.g., "none")
+std::uint64_t hashFile(const Filename& fname) {
+    MappedFile file{fname};
+    const unsigned char* p = 
+            reinterpret_cast<const unsigned char*>(file.data());
+    std::size_t size = file.size();
+    if (size == 0) {
+        p = reinterpret_cast<const unsigned char*>(fname.data());
+        size = fname.size();
+    }
+
+    std::uint64_t h = 14695981039346656037ull;
+    for (std::size_t i = 0; i < size; ++i) {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// Return the hash of the files, combined in order
+std::uint64_t hashFiles(const std::vector<Filename>& fnames) {
+    std::uint64_t h = 14695981039346656037ull;
+    for (const Filename& fname : fnames)
+        h = (h ^ hashFile(fname)) * 1099511628211ull;
+    return h;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// Snapshot Writer
+
+// Writes values into a snapshot file (through a temporary file, so that an 
+// interrupted write does not leave a truncated snapshot). Values that are 
+// trivially copyable are written as bytes, containers as their size and 
+// elements, and other classes by their save() method.
+class SnapshotWriter {
+public:
+
+    // Constructor
+    SnapshotWriter(const Filename& fname, const SnapshotHeader& h);
+
+    // Modifiers
+    template<class T, class... Ts>
+    void put(const T& x, const Ts&... xs);
+    bool close();
+
+private:
+
+    // Writing of each kind of value
+    template<class T>
+    std::enable_if_t<std::is_trivially_copyable_v<T>> putOne(const T& x);
+    template<class T>
+    std::enable_if_t<!std::is_trivially_copyable_v<T>, 
+                     decltype(std::declval<const T&>().save( 
+                             std::declval<SnapshotWriter&>()))>
+    putOne(const T& x);
+    void putOne(const std::string& x);
+    void putOne(const std::vector<bool>& x);
+    template<class T> void putOne(const std::vector<T>& x);
+    template<class T> void putOne(const std::deque<T>& x);
+    template<class T> void putOne(const std::set<T>& x);
+    template<class K, class V> void putOne(const std::map<K, V>& x);
+    template<class K, class V> void putOne(const std::unordered_map<K, V>& x);
+    template<class A, class B> void putOne(const std::pair<A, B>& x);
+    template<class... Ts> void putOne(const std::variant<Ts...>& x);
+    template<class C> void putRange(const C& x);
+
+    Filename fname, tmp;
+    std::ofstream file;
+
+};
+
+// Open a temporary file for the snapshot fname, and write the header
+SnapshotWriter::SnapshotWriter(const Filename& fname, const SnapshotHeader& h)
+    : fname{fname}, tmp{fname + ".tmp"}, file{tmp, std::ios::binary}
+{ putOne(h); }
+
+// Write the values
+template<class T, class... Ts>
+void SnapshotWriter::put(const T& x, const Ts&... xs) {
+    putOne(x);
+    (putOne(xs), ...);
+}
+
+// Complete the size in the header, and replace the snapshot with the written 
+// file. Return false (and remove the file) if it could not be written.
+bool SnapshotWriter::close() {
+    std::uint64_t size = file.tellp();
+    file.seekp(offsetof(SnapshotHeader, size));
+    putOne(size);
+    file.close();
+    if (!file || std::rename(tmp.c_str(), fname.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Write the bytes of a trivially copyable value
+template<class T>
+std::enable_if_t<std::is_trivially_copyable_v<T>>
+SnapshotWriter::putOne(const T& x)
+{ file.write(reinterpret_cast<const char*>(&x), sizeof x); }
+
+// Write a value by its save() method
+template<class T>
+std::enable_if_t<!std::is_trivially_copyable_v<T>, 
+                 decltype(std::declval<const T&>().save( 
+                         std::declval<SnapshotWriter&>()))>
+SnapshotWriter::putOne(const T& x)
+{ x.save(*this); }
+
+// Write a string
+void SnapshotWriter::putOne(const std::string& x) {
+    putOne(std::uint64_t(x.size()));
+    file.write(x.data(), x.size());
+}
+
+// Write a vector of bools (as one byte each)
+void SnapshotWriter::putOne(const std::vector<bool>& x) {
+    putOne(std::uint64_t(x.size()));
+    for (bool b : x)
+        putOne(b);
+}
+
+// Write a vector (the elements as one block if trivially copyable)
+template<class T>
+void SnapshotWriter::putOne(const std::vector<T>& x) {
+    if constexpr (std::is_trivially_copyable_v<T>) {
+        putOne(std::uint64_t(x.size()));
+        file.write(reinterpret_cast<const char*>(x.data()), x.size()*sizeof(T));
+    }
+    else
+        putRange(x);
+}
+
+// Write a deque, set or map
+template<class T>
+void SnapshotWriter::putOne(const std::deque<T>& x) { putRange(x); }
+template<class T>
+void SnapshotWriter::putOne(const std::set<T>& x) { putRange(x); }
+template<class K, class V>
+void SnapshotWriter::putOne(const std::map<K, V>& x) { putRange(x); }
+template<class K, class V>
+void SnapshotWriter::putOne(const std::unordered_map<K, V>& x)
+{ putRange(x); }
+
+// Write a pair
+template<class A, class B>
+void SnapshotWriter::putOne(const std::pair<A, B>& x) {
+    putOne(x.first);
+    putOne(x.second);
+}
+
+// Write a variant (the index of the alternative, and its value)
+template<class... Ts>
+void SnapshotWriter::putOne(const std::variant<Ts...>& x) {
+    putOne(std::uint32_t(x.index()));
+    std::visit([this](const auto& y) { putOne(y); }, x);
+}
+
+// Write the size and the elements of a container
+template<class C>
+void SnapshotWriter::putRange(const C& x) {
+    putOne(std::uint64_t(x.size()));
+    for (const auto& y : x)
+        putOne(y);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// Snapshot Reader
+
+// Reads values from a memory-mapped snapshot file, as written by 
+// SnapshotWriter (the values are read in the order that they were written)
+class SnapshotReader {
+public:
+
+    // Constructor
+    explicit SnapshotReader(const Filename& fname);
+
+    // Queries
+    bool valid(std::uint64_t inputs) const;
+    bool valid(std::uint64_t inputs, std::uint64_t entities) const;
+
+    // Modifiers
+    template<class T, class... Ts>
+    void get(T& x, Ts&... xs);
+
+private:
+
+    // Reading of each kind of value
+    template<class T>
+    std::enable_if_t<std::is_trivially_copyable_v<T>> getOne(T& x);
+    template<class T>
+    std::enable_if_t<!std::is_trivially_copyable_v<T>, 
+                     decltype(std::declval<T&>().load( 
+                             std::declval<SnapshotReader&>()))>
+    getOne(T& x);
+    void getOne(std::string& x);
+    void getOne(std::vector<bool>& x);
+    template<class T> void getOne(std::vector<T>& x);
+    template<class T> void getOne(std::deque<T>& x);
+    template<class T> void getOne(std::set<T>& x);
+    template<class K, class V> void getOne(std::map<K, V>& x);
+    template<class K, class V> void getOne(std::unordered_map<K, V>& x);
+    template<class A, class B> void getOne(std::pair<A, B>& x);
+    template<class... Ts> void getOne(std::variant<Ts...>& x);
+    template<std::size_t I, class... Ts>
+    void getAlternative(std::variant<Ts...>& x, std::size_t i);
+    const char* take(std::size_t bytes);
+
+    MappedFile file;
+    SnapshotHeader h;
+    std::size_t pos = 0;
+
+};
+
+// Map the snapshot file, and read its header
+SnapshotReader::SnapshotReader(const Filename& fname) : file{fname} {
+    std::memset(&h, 0, sizeof h);
+    if (file.size() >= sizeof h)
+        getOne(h);
+}
+
+// Return whether the snapshot is complete, in the current format, and of the 
+// input files with the given hash (and the entities with the given hash)
+bool SnapshotReader::valid(std::uint64_t inputs) const {
+    return std::memcmp(h.magic, snapshotMagic, sizeof h.magic) == 0 && 
+           h.version == snapshotVersion && 
+           h.size == file.size() && 
+           h.inputs == inputs;
+}
+bool SnapshotReader::valid(std::uint64_t inputs, std::uint64_t entities) const
+{ return valid(inputs) && h.entities == entities; }
+
+// Read the values
+template<class T, class... Ts>
+void SnapshotReader::get(T& x, Ts&... xs) {
+    getOne(x);
+    (getOne(xs), ...);
+}
+
+// Read the bytes of a trivially copyable value
+template<class T>
+std::enable_if_t<std::is_trivially_copyable_v<T>>
+SnapshotReader::getOne(T& x)
+{ std::memcpy(&x, take(sizeof x), sizeof x); }
+
+// Read a value by its load() method
+template<class T>
+std::enable_if_t<!std::is_trivially_copyable_v<T>, 
+                 decltype(std::declval<T&>().load( 
+                         std::declval<SnapshotReader&>()))>
+SnapshotReader::getOne(T& x)
+{ x.load(*this); }
+
+// Read a string
+void SnapshotReader::getOne(std::string& x) {
+    std::uint64_t n;
+    getOne(n);
+    x.assign(take(n), n);
+}
+
+// Read a vector of bools
+void SnapshotReader::getOne(std::vector<bool>& x) {
+    std::uint64_t n;
+    getOne(n);
+    x.resize(n);
+    for (std::uint64_t i = 0; i < n; ++i) {
+        bool b;
+        getOne(b);
+        x[i] = b;
+    }
+}
+
+// Read a vector (the elements as one block if trivially copyable)
+template<class T>
+void SnapshotReader::getOne(std::vector<T>& x) {
+    std::uint64_t n;
+    getOne(n);
+    x.resize(n);
+    if constexpr (std::is_trivially_copyable_v<T>)
+        std::memcpy(x.data(), take(n * sizeof(T)), n * sizeof(T));
+    else {
+        for (T& y : x)
+            getOne(y);
+    }
+}
+
+// Read a deque
+template<class T>
+void SnapshotReader::getOne(std::deque<T>& x) {
+    std::uint64_t n;
+    getOne(n);
+    x.resize(n);
+    for (T& y : x)
+        getOne(y);
+}
+
+// Read a set
+template<class T>
+void SnapshotReader::getOne(std::set<T>& x) {
+    std::uint64_t n;
+    getOne(n);
+    x.clear();
+    for (std::uint64_t i = 0; i < n; ++i) {
+        T y;
+        getOne(y);
+        x.insert(x.end(), std::move(y));
+    }
+}
+
+// Read a map
+template<class K, class V>
+void SnapshotReader::getOne(std::map<K, V>& x) {
+    std::uint64_t n;
+    getOne(n);
+    x.clear();
+    for (std::uint64_t i = 0; i < n; ++i) {
+        std::pair<K, V> y;
+        getOne(y);
+        x.insert(x.end(), std::move(y));
+    }
+}
+
+// Read an unordered map
+template<class K, class V>
+void SnapshotReader::getOne(std::unordered_map<K, V>& x) {
+    std::uint64_t n;
+    getOne(n);
+    x.clear();
+    x.reserve(n);
+    for (std::uint64_t i = 0; i < n; ++i) {
+        std::pair<K, V> y;
+        getOne(y);
+        x.insert(std::move(y));
+    }
+}
+
+// Read a pair
+template<class A, class B>
+void SnapshotReader::getOne(std::pair<A, B>& x) {
+    getOne(x.first);
+    getOne(x.second);
+}
+
+// Read a variant (the index of the alternative, and its value)
+template<class... Ts>
+void SnapshotReader::getOne(std::variant<Ts...>& x) {
+    std::uint32_t i;
+    getOne(i);
+    getAlternative<0>(x, i);
+}
+
+// Read the alternative i (of at least I) of a variant
+template<std::size_t I, class... Ts>
+void SnapshotReader::getAlternative(std::variant<Ts...>& x, std::size_t i) {
+    if constexpr (I < sizeof...(Ts)) {
+        if (i == I) {
+            std::variant_alternative_t<I, std::variant<Ts...>> y;
+            getOne(y);
+            x = std::move(y);
+        }
+        else
+            getAlternative<I+1>(x, i);
+    }
+    else {
+        std::cerr << "SnapshotReader Error: invalid snapshot" << std::endl;
+        exitOnError();
+    }
+}
+
+// Return the next bytes of the file
+const char* SnapshotReader::take(std::size_t bytes) {
+    if (bytes > file.size() - pos) {
+        std::cerr << "SnapshotReader Error: truncated snapshot" << std::endl;
+        exitOnError();
+    }
+    const char* p = file.data() + pos;
+    pos += bytes;
+    return p;
+}
+
+#endif // UTILS_SNAPSHOT_HPP
@@ -0,0 +1,30 @@
+#ifndef UTILS_THREAD_POOL_HPP
+#define UTILS_THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "Typedefs.hpp"
+
+// Call f(i) for each i in [0, n) on a pool of threads (one i per task, and 
+// one thread per hardware thread), which includes the calling thread
+template<class F>
+void parallelFor(Index n, F f) {
+    std::atomic<Index> next{0};
+    auto worker = [&]() {
+        for (Index i = next++; i < n; i = next++)
+            f(i);
+    };
+
+    int nthreads = std::max<int>(1, std::thread::hardware_concurrency());
+    std::vector<std::thread> pool;
+    for (int i = 1; i < std::min<int>(nthreads, n); ++i)
+        pool.emplace_back(worker);
+    worker();
+    for (std::thread& t : pool)
+        t.join();
+}
+
+#endif // UTILS_THREAD_POOL_HPP
@@ -7,9 +7,14 @@
 #include <vector>
 #include <algorithm>
 #include <utility>
-#include <memory>
+#include <variant>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
 
 #include "../include/rapidjson/document.h"
+#include "../include/rapidjson/stringbuffer.h"
+#include "../include/rapidjson/writer.h"
 #include "../include/date/date.h"
 #include "../include/date/iso_week.h"
 
@@ -17,6 +22,7 @@
 #include "IOUtils.hpp"
 #include "RandomGenerator.hpp"
 #include "NormalDistributions.hpp"
+#include "Snapshot.hpp"
 
 namespace {
 
@@ -29,80 +35,135 @@ namespace {
 ////////////////////////////////////////////////////////////////////////////////
 // Period Details (part of TP Pattern)
 
-// The general class containing attributes for period details
-class PD {
-public: 
+// Period details are a closed set of rules. Each rule answers whether a date
+// is active in constant time, and enumerates its active dates within a range
+// of days on demand, so no list of dates is stored.
+
+// The attributes common to all period details
+struct PD {
+
     // Constructors
     PD();
     PD(const rj::Value& det, const Date& s, const Date& e);
-    
-    // Queries
-    const DateList& dates() const;
-
-    // I/O
-    std::ostream& print(std::ostream& oss);
 
-protected: 
-    
     // Frequency of repitition
     int rep=1;
 
     // Start/end date
     Date s, e;
 
-    // Precomputed list of dates
-    DateList dl;
-
 };
 
 // Period details for day pattern
-class DayPD : public PD {
-public:
+struct DayPD : public PD {
+    DayPD();
     DayPD(const rj::Value& det, const Date& s, const Date& e);
+    bool active(const Date& d) const;
+    template<class F> void forEach(const Date& lo, const Date& hi, F f) const;
 };
 
 // Period details for week pattern
-class WeekPD : public PD {
-public:
+struct WeekPD : public PD {
+    WeekPD();
     WeekPD(const rj::Value& det, const Date& s, const Date& e);
+    bool active(const Date& d) const;
+    template<class F> void forEach(const Date& lo, const Date& hi, F f) const;
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
+
+    // Offsets (in days) of the days of week from the start date
+    std::vector<int> offsets;
 };
 
 // Period details for month pattern, specifying days of month
-class MonthPD_Day : public PD {
-public:
+struct MonthPD_Day : public PD {
+    MonthPD_Day();
     MonthPD_Day(const rj::Value& det, const Date& s, const Date& e);
+    bool active(const Date& d) const;
+    template<class F> void forEach(const Date& lo, const Date& hi, F f) const;
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
+
+    std::vector<int> dom;
+    long back;
 };
 
 // Period details for month pattern, specifying weeks of month
-class MonthPD_Week : public PD {
-public:
+struct MonthPD_Week : public PD {
+    MonthPD_Week();
     MonthPD_Week(const rj::Value& det, const Date& s, const Date& e);
+    bool active(const Date& d) const;
+    template<class F> void forEach(const Date& lo, const Date& hi, F f) const;
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
+
+    std::vector<int> wom, dow;
+    long back;
 };
 
 // Period details for year pattern, specifying days of year
-class YearPD_Day : public PD {
-public:
+struct YearPD_Day : public PD {
+    YearPD_Day();
     YearPD_Day(const rj::Value& det, const Date& s, const Date& e);
+    bool active(const Date& d) const;
+    template<class F> void forEach(const Date& lo, const Date& hi, F f) const;
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
+
+    std::vector<int> doy;
+    long back, ahead;
 };
 
 // Period details for year pattern, specifying weeks of year
-class YearPD_Week : public PD {
-public:
+struct YearPD_Week : public PD {
+    YearPD_Week();
     YearPD_Week(const rj::Value& det, const Date& s, const Date& e);
+    bool active(const Date& d) const;
+    template<class F> void forEach(const Date& lo, const Date& hi, F f) const;
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
+
+    std::vector<int> woy, dow;
+    long back;
 };
 
 // Period details for year pattern, specifying of months of year, days of month
-class YearPD_MonthDay : public PD {
-public:
+struct YearPD_MonthDay : public PD {
+    YearPD_MonthDay();
     YearPD_MonthDay(const rj::Value& det, const Date& s, const Date& e);
+    bool active(const Date& d) const;
+    template<class F> void forEach(const Date& lo, const Date& hi, F f) const;
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
+
+    std::vector<int> moy, dom;
+    long back;
 };
 
 // Period details for year pattern, specifying of months of year, weeks of month
-class YearPD_MonthWeek : public PD {
-public:
+struct YearPD_MonthWeek : public PD {
+    YearPD_MonthWeek();
     YearPD_MonthWeek(const rj::Value& det, const Date& s, const Date& e);
+    bool active(const Date& d) const;
+    template<class F> void forEach(const Date& lo, const Date& hi, F f) const;
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
+
+    std::vector<int> moy, wom, dow;
+    long back;
 };
 
+// Any of the period details
+using PeriodDetails = std::variant<
+        DayPD, 
+        WeekPD, 
+        MonthPD_Day, 
+        MonthPD_Week, 
+        YearPD_Day, 
+        YearPD_Week, 
+        YearPD_MonthDay, 
+        YearPD_MonthWeek>;
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 // Time Profile Pattern class
@@ -117,9 +178,14 @@ public:
     explicit TPPattern(const rj::Value& pat);
 
     // Queries
-    const DateList& dates() const;
+    bool contains(const Date& d) const;
+
+    // Modifiers
+    void compile(const Date& hs, const Date& he);
 
     // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     friend std::ostream& operator<<(std::ostream& oss, const TPPattern& p);
 
 private: 
@@ -130,8 +196,12 @@ private:
     // Period, specifying what values can be specified in the period details
     Period period;
 
-    // Pointer to the period details
-    std::shared_ptr<PD> det;
+    // The period details
+    PeriodDetails det;
+
+    // A cache of the dates of the pattern within the simulated days (see 
+    // compile()); other dates are evaluated by the period details
+    DateBitset dates;
 
 };
 
@@ -152,27 +222,166 @@ public:
         NormalTime start, end;
         NormalTime req;
         bool recur;
+
+        void save(SnapshotWriter& w) const;
+        void load(SnapshotReader& r);
     };
 
     // Queries
     TimePeriod query(const DateTime& eta, bool useETA=true);
+    bool active(const DateTime& dt) const;
+
+    // Modifiers
+    void compile(const Date& hs, const Date& he);
 
     // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
     friend std::ostream& operator<<(std::ostream& oss, const TimeProfile& tp);
 
 private:
 
+    // Private helper methods
+    bool activeEntry(Index i, const Date& d) const;
+
     // A list of time profile entries
     std::vector<TimeProfileEntry> tp;
 
+    // The activity calendar of the simulated days (see compile()): the first 
+    // day, the active days, and the active windows (start/end times) of each 
+    // day, which are windows[offsets[k]] to windows[offsets[k+1]-1] for day k
+    date::sys_days first;
+    DateBitset days;
+    std::vector<Index> offsets;
+    std::vector<std::pair<Time, Time>> windows;
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// Time Profile Pool
+
+// The distinct time profiles that have been read. Identical profiles (e.g., 
+// "weekdays 9-5" shared by many metaevents and constraints) are stored once, 
+// and are referred to by handle (see TimeProfileRef). Profiles may be added 
+// by several threads at once (e.g., as the input files are read 
+// concurrently); the other methods are not synchronized.
+class TimeProfilePool {
+public:
+
+    // Queries
+    int size() const;
+    TimeProfile& operator[](Index h);
+
+    // Modifiers
+    Index add(const rj::Value& profileList);
+    void compile(const Date& hs, const Date& he);
+
+    // I/O
+    void save(SnapshotWriter& w) const;
+    void load(SnapshotReader& r);
+
+private:
+
+    // A map of the serialized profile list to its handle in `entries`
+    std::unordered_map<std::string, Index> loc;
+
+    // A list of time profiles (references stay valid as profiles are added)
+    std::deque<TimeProfile> entries;
+
+    // Guards loc and entries as profiles are added
+    std::mutex m;
+
+};
+
+// A handle to a time profile in the pool. The default handle refers to an 
+// empty time profile, which is never active.
+class TimeProfileRef {
+public:
+
+    // Constructors
+    TimeProfileRef();
+    explicit TimeProfileRef(const rj::Value& profileList);
+
+    // Queries
+    TimePeriod query(const DateTime& eta, bool useETA=true) const;
+    bool active(const DateTime& dt) const;
+
+    // I/O
+    friend std::ostream& operator<<(std::ostream& oss, const TimeProfileRef& t);
+
+private:
+
+    // The index of the time profile in the pool
+    Index h = -1;
+
 };
 
 // Useful Typedefs
-using TimeProfileList = std::vector<TimeProfile>;
+using TimeProfileList = std::vector<TimeProfileRef>;
 
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 // Implementations for Period Details
+namespace {
+
+    // Return the number of months from date a to date b
+    long monthsBetween(const Date& a, const Date& b) {
+        return (int(b.year()) - int(a.year())) * 12 + 
+               (long(unsigned(b.month())) - long(unsigned(a.month())));
+    }
+
+    // Return the number of years from date a to date b
+    long yearsBetween(const Date& a, const Date& b) 
+    { return int(b.year()) - int(a.year()); }
+
+    // Return the maximum of the values in v (or 0 if empty)
+    long maxOf(const std::vector<int>& v) 
+    { return v.empty() ? 0 : *std::max_element(v.begin(), v.end()); }
+
+    // Return the minimum of the values in v (or 0 if empty)
+    long minOf(const std::vector<int>& v) 
+    { return v.empty() ? 0 : *std::min_element(v.begin(), v.end()); }
+
+    // Return the first multiple of rep that is at least max(0, n)
+    long firstStep(long n, int rep) 
+    { return n <= 0 ? 0 : (n + rep-1) / rep * rep; }
+
+    // Call f(curr) for each step curr of rep months from date s, between n0
+    // and n1 months from s, as long as curr is not after date e. Returns true 
+    // as soon as f does.
+    template<class F>
+    bool anyMonthStep(const Date& s, const Date& e, int rep, 
+                      long n0, long n1, F f) {
+        for (long n = firstStep(n0, rep); n <= n1; n += rep) {
+            Date curr = s;
+            curr += date::months{n};
+            if (e < curr)
+                break;
+            if (f(curr))
+                return true;
+        }
+        return false;
+    }
+
+    // Call f(curr) for each step curr of rep years from date s, between n0 
+    // and n1 years from s, as long as curr is not after date e. Returns true 
+    // as soon as f does.
+    template<class F>
+    bool anyYearStep(const Date& s, const Date& e, int rep, 
+                     long n0, long n1, F f) {
+        for (long n = firstStep(n0, rep); n <= n1; n += rep) {
+            Date curr = s;
+            curr += date::years{n};
+            if (e < curr)
+                break;
+            if (f(curr))
+                return true;
+        }
+        return false;
+    }
+
+} // end namespace
 
 // Default Constructor
 PD::PD() {}
@@ -185,145 +394,368 @@ PD::PD(const rj::Value& det, const Date& s, const Date& e)
         rep = it->value.GetInt();
 }
 
-// Return the list of dates associated with the period details
-const DateList& PD::dates() const { return dl; }
-
-// Print the period details
-std::ostream& PD::print(std::ostream& oss) {
-    oss << "[";
-    if (!dl.empty()) {
-        DateList::const_iterator it = dl.begin();
-        oss << *it++;
-        for (; it != dl.end(); ++it)
-            oss << ", " << *it;
-    }
-    oss << "]";
-    return oss;
-}
+// Default Constructor
+DayPD::DayPD() {}
 
 // Construct PD for a day
 DayPD::DayPD(const rj::Value& det, const Date& s, const Date& e)
-    : PD{det, s, e} {
+    : PD{det, s, e} {}
+
+// Return whether the day pattern is active on date d
+bool DayPD::active(const Date& d) const {
+    long diff = (date::sys_days{d} - date::sys_days{s}).count();
+    return diff >= 0 && diff % rep == 0 && !(e < d);
+}
+
+// Call f for each date of the day pattern between lo and hi
+template<class F>
+void DayPD::forEach(const Date& lo, const Date& hi, F f) const {
     date::days dInc{rep};
-    for (date::sys_days curr = s; curr <= e; curr += dInc)
-        dl.push_back(Date{curr});
+    date::sys_days curr = s;
+    curr += date::days{firstStep((date::sys_days{lo} - curr).count(), rep)};
+    for (; curr <= date::sys_days{hi}; curr += dInc)
+        f(Date{curr});
 }
 
+// Default Constructor
+WeekPD::WeekPD() {}
+
+// Write the period details into the snapshot
+void WeekPD::save(SnapshotWriter& w) const 
+{ w.put(rep, s, e, offsets); }
+
+// Read the period details from the snapshot
+void WeekPD::load(SnapshotReader& r) 
+{ r.get(rep, s, e, offsets); }
+
 // Construct PD for a week
 WeekPD::WeekPD(const rj::Value& det, const Date& s, const Date& e)
     : PD{det, s, e} {
-    date::days wInc{7 * rep};
     int startDay = date::weekday(s).c_encoding();
-    for (const rj::Value& v : det["days-of-week"].GetArray()) {
-        date::days diff{(v.GetInt() - startDay + 7) % 7};
-        for (date::sys_days curr = date::sys_days{s}+diff; 
-                curr <= e; 
-                curr += wInc)
-            dl.push_back(Date{curr});
+    for (int v : parseIntArr(det, "days-of-week"))
+        offsets.push_back((v - startDay + 7) % 7);
+}
+
+// Return whether the week pattern is active on date d
+bool WeekPD::active(const Date& d) const {
+    if (e < d)
+        return false;
+    long diff = (date::sys_days{d} - date::sys_days{s}).count();
+    for (int o : offsets)
+        if (diff >= o && (diff - o) % (7*rep) == 0)
+            return true;
+    return false;
+}
+
+// Call f for each date of the week pattern between lo and hi
+template<class F>
+void WeekPD::forEach(const Date& lo, const Date& hi, F f) const {
+    date::days wInc{7 * rep};
+    for (int o : offsets) {
+        date::sys_days curr = date::sys_days{s} + date::days{o};
+        curr += date::days{
+                firstStep((date::sys_days{lo} - curr).count(), 7*rep)};
+        for (; curr <= date::sys_days{hi}; curr += wInc)
+            f(Date{curr});
     }
 }
 
-// Construct PD for a month, specifying days of month
+// Default Constructor
+MonthPD_Day::MonthPD_Day() {}
+
+// Write the period details into the snapshot
+void MonthPD_Day::save(SnapshotWriter& w) const 
+{ w.put(rep, s, e, dom, back); }
+
+// Read the period details from the snapshot
+void MonthPD_Day::load(SnapshotReader& r) 
+{ r.get(rep, s, e, dom, back); }
+
+// Construct PD for a month, specifying days of month. Days past the end of a
+// month roll over into the following months.
 MonthPD_Day::MonthPD_Day(const rj::Value& det, const Date& s, const Date& e)
-    : PD{det, s, e} {
-    date::months mInc{rep};
-    for (const rj::Value& v : det["days-of-month"].GetArray()) {
-        for (Date curr = s; curr <= e; curr += mInc) {
-            Date next{curr.year()/curr.month()/v.GetInt()};
-            if (s <= next && next <= e && next.ok())
-                dl.push_back(next);
+    : PD{det, s, e}, dom{parseIntArr(det, "days-of-month")} 
+{ back = std::max(0L, maxOf(dom)-1) / 28 + 1; }
+
+// Return whether the month pattern is active on date d
+bool MonthPD_Day::active(const Date& d) const {
+    if (d < s || e < d)
+        return false;
+    long n = monthsBetween(s, d);
+    return anyMonthStep(s, e, rep, n-back, n+1, [&](const Date& curr) {
+        for (int v : dom)
+            if (Date{curr.year()/curr.month()/v} == d)
+                return true;
+        return false;
+    });
+}
+
+// Call f for each date of the month pattern between lo and hi
+template<class F>
+void MonthPD_Day::forEach(const Date& lo, const Date& hi, F f) const {
+    long n0 = monthsBetween(s, lo) - back, n1 = monthsBetween(s, hi) + 1;
+    anyMonthStep(s, e, rep, n0, n1, [&](const Date& curr) {
+        for (int v : dom) {
+            Date next{curr.year()/curr.month()/v};
+            if (lo <= next && next <= hi)
+                f(next);
         }
-    }
+        return false;
+    });
 }
 
-// Construct PD for a month, specifying weeks of month
+// Default Constructor
+MonthPD_Week::MonthPD_Week() {}
+
+// Write the period details into the snapshot
+void MonthPD_Week::save(SnapshotWriter& w) const 
+{ w.put(rep, s, e, wom, dow, back); }
+
+// Read the period details from the snapshot
+void MonthPD_Week::load(SnapshotReader& r) 
+{ r.get(rep, s, e, wom, dow, back); }
+
+// Construct PD for a month, specifying weeks of month. Weeks past the end of
+// a month roll over into the following months.
 MonthPD_Week::MonthPD_Week(const rj::Value& det, const Date& s, const Date& e)
-    : PD{det, s, e} {
-    date::months mInc{rep};
-    for (const rj::Value& w : det["weeks-of-month"].GetArray()) {
-        for (const rj::Value& d : det["days-of-week"].GetArray()) {
-            for (Date curr = s; curr <= e; curr += mInc) {
-                Date next{curr.year()/
-                        curr.month()/
-                        date::weekday(d.GetInt())[w.GetInt()]};
-                if (s <= next && next <= e && next.ok())
-                    dl.push_back(next);
+    : PD{det, s, e}, 
+      wom{parseIntArr(det, "weeks-of-month")}, 
+      dow{parseIntArr(det, "days-of-week")} 
+{ back = (std::max(0L, maxOf(wom)) * 7 + 6) / 28 + 1; }
+
+// Return whether the month pattern is active on date d
+bool MonthPD_Week::active(const Date& d) const {
+    if (d < s || e < d)
+        return false;
+    long n = monthsBetween(s, d);
+    return anyMonthStep(s, e, rep, n-back, n+1, [&](const Date& curr) {
+        for (int w : wom)
+            for (int x : dow)
+                if (Date{curr.year()/curr.month()/date::weekday(x)[w]} == d)
+                    return true;
+        return false;
+    });
+}
+
+// Call f for each date of the month pattern between lo and hi
+template<class F>
+void MonthPD_Week::forEach(const Date& lo, const Date& hi, F f) const {
+    long n0 = monthsBetween(s, lo) - back, n1 = monthsBetween(s, hi) + 1;
+    anyMonthStep(s, e, rep, n0, n1, [&](const Date& curr) {
+        for (int w : wom) {
+            for (int x : dow) {
+                Date next{curr.year()/curr.month()/date::weekday(x)[w]};
+                if (lo <= next && next <= hi)
+                    f(next);
             }
         }
-    }
+        return false;
+    });
 }
 
-// Construct PD for a year, specifying days of year
+// Default Constructor
+YearPD_Day::YearPD_Day() {}
+
+// Write the period details into the snapshot
+void YearPD_Day::save(SnapshotWriter& w) const 
+{ w.put(rep, s, e, doy, back, ahead); }
+
+// Read the period details from the snapshot
+void YearPD_Day::load(SnapshotReader& r) 
+{ r.get(rep, s, e, doy, back, ahead); }
+
+// Construct PD for a year, specifying days of year. Days of year are offsets 
+// from the end of the month before the start month.
 YearPD_Day::YearPD_Day(const rj::Value& det, const Date& s, const Date& e)
-    : PD{det, s, e} {
-    date::years yInc{rep};
-    for (const rj::Value& v : det["days-of-year"].GetArray()) {
-        for (Date curr = s; curr <= e; curr += yInc) {
+    : PD{det, s, e}, doy{parseIntArr(det, "days-of-year")} {
+    back  = std::max(0L, maxOf(doy)) / 365 + 1;
+    ahead = std::max(0L, -minOf(doy)) / 365 + 2;
+}
+
+// Return whether the year pattern is active on date d
+bool YearPD_Day::active(const Date& d) const {
+    if (d < s || e < d)
+        return false;
+    long n = yearsBetween(s, d);
+    return anyYearStep(s, e, rep, n-back, n+ahead, [&](const Date& curr) {
+        for (int v : doy)
+            if (Date{date::sys_days{curr.year()/curr.month()/0} + 
+                     date::days{v}} == d)
+                return true;
+        return false;
+    });
+}
+
+// Call f for each date of the year pattern between lo and hi
+template<class F>
+void YearPD_Day::forEach(const Date& lo, const Date& hi, F f) const {
+    long n0 = yearsBetween(s, lo) - back, n1 = yearsBetween(s, hi) + ahead;
+    anyYearStep(s, e, rep, n0, n1, [&](const Date& curr) {
+        for (int v : doy) {
             Date next{date::sys_days{curr.year()/curr.month()/0} + 
-                      date::days{v.GetInt()}};
-            if (s <= next && next <= e)
-                dl.push_back(next);
+                      date::days{v}};
+            if (lo <= next && next <= hi)
+                f(next);
         }
-    }
+        return false;
+    });
 }
 
-// Construct PD for a year, specifying weeks of year
+// Default Constructor
+YearPD_Week::YearPD_Week() {}
+
+// Write the period details into the snapshot
+void YearPD_Week::save(SnapshotWriter& w) const 
+{ w.put(rep, s, e, woy, dow, back); }
+
+// Read the period details from the snapshot
+void YearPD_Week::load(SnapshotReader& r) 
+{ r.get(rep, s, e, woy, dow, back); }
+
+// Construct PD for a year, specifying weeks of year. Weeks are counted in the
+// ISO year of each step, which may differ from its calendar year.
 YearPD_Week::YearPD_Week(const rj::Value& det, const Date& s, const Date& e)
-    : PD{det, s, e} {
-    date::years yInc{rep};
-    for (const rj::Value& w : det["weeks-of-year"].GetArray()) {
-        for (const rj::Value& d : det["days-of-week"].GetArray()) {
-            for (Date curr = s; curr <= e; curr += yInc) {
-                iso_week::year_weeknum_weekday yww =
-                        iso_week::year_weeknum_weekday{curr}.year()/
-                        w.GetInt()/
-                        d.GetInt();
-                Date next{yww};
-                if (s <= next && next <= e)
-                    dl.push_back(next);
+    : PD{det, s, e}, 
+      woy{parseIntArr(det, "weeks-of-year")}, 
+      dow{parseIntArr(det, "days-of-week")} 
+{ back = std::max(0L, maxOf(woy)) / 52 + 2; }
+
+// Return whether the year pattern is active on date d
+bool YearPD_Week::active(const Date& d) const {
+    if (d < s || e < d)
+        return false;
+    long n = yearsBetween(s, d);
+    return anyYearStep(s, e, rep, n-back, n+2, [&](const Date& curr) {
+        for (int w : woy)
+            for (int x : dow)
+                if (Date{iso_week::year_weeknum_weekday{curr}.year()/w/x} == d)
+                    return true;
+        return false;
+    });
+}
+
+// Call f for each date of the year pattern between lo and hi
+template<class F>
+void YearPD_Week::forEach(const Date& lo, const Date& hi, F f) const {
+    long n0 = yearsBetween(s, lo) - back, n1 = yearsBetween(s, hi) + 2;
+    anyYearStep(s, e, rep, n0, n1, [&](const Date& curr) {
+        for (int w : woy) {
+            for (int x : dow) {
+                Date next{iso_week::year_weeknum_weekday{curr}.year()/w/x};
+                if (lo <= next && next <= hi)
+                    f(next);
             }
         }
-    }
+        return false;
+    });
 }
 
-// Construct PD for a year, specifying months of year, days of month
+// Default Constructor
+YearPD_MonthDay::YearPD_MonthDay() {}
+
+// Write the period details into the snapshot
+void YearPD_MonthDay::save(SnapshotWriter& w) const 
+{ w.put(rep, s, e, moy, dom, back); }
+
+// Read the period details from the snapshot
+void YearPD_MonthDay::load(SnapshotReader& r) 
+{ r.get(rep, s, e, moy, dom, back); }
+
+// Construct PD for a year, specifying months of year, days of month. Days 
+// past the end of a month roll over into the following months.
 YearPD_MonthDay::YearPD_MonthDay(
         const rj::Value& det, 
         const Date& s, 
         const Date& e)
-    : PD{det, s, e} {
-    date::years yInc{rep};
-    for (const rj::Value& m : det["months-of-year"].GetArray()) {
-        for (const rj::Value& d : det["days-of-month"].GetArray()) {
-            for (Date curr = s; curr <= e; curr += yInc) {
-                Date next{curr.year()/m.GetInt()/d.GetInt()};
-                if (s <= next && next <= e)
-                    dl.push_back(next);
+    : PD{det, s, e}, 
+      moy{parseIntArr(det, "months-of-year")}, 
+      dom{parseIntArr(det, "days-of-month")} 
+{ back = std::max(0L, maxOf(moy)-1) / 12 + std::max(0L, maxOf(dom)) / 365 + 1; }
+
+// Return whether the year pattern is active on date d
+bool YearPD_MonthDay::active(const Date& d) const {
+    if (d < s || e < d)
+        return false;
+    long n = yearsBetween(s, d);
+    return anyYearStep(s, e, rep, n-back, n+1, [&](const Date& curr) {
+        for (int m : moy)
+            for (int x : dom)
+                if (Date{curr.year()/m/x} == d)
+                    return true;
+        return false;
+    });
+}
+
+// Call f for each date of the year pattern between lo and hi
+template<class F>
+void YearPD_MonthDay::forEach(const Date& lo, const Date& hi, F f) const {
+    long n0 = yearsBetween(s, lo) - back, n1 = yearsBetween(s, hi) + 1;
+    anyYearStep(s, e, rep, n0, n1, [&](const Date& curr) {
+        for (int m : moy) {
+            for (int x : dom) {
+                Date next{curr.year()/m/x};
+                if (lo <= next && next <= hi)
+                    f(next);
             }
         }
-    }
+        return false;
+    });
 }
 
-// Construct PD for a year, specifying months of year, weeks of month
+// Default Constructor
+YearPD_MonthWeek::YearPD_MonthWeek() {}
+
+// Write the period details into the snapshot
+void YearPD_MonthWeek::save(SnapshotWriter& w) const 
+{ w.put(rep, s, e, moy, wom, dow, back); }
+
+// Read the period details from the snapshot
+void YearPD_MonthWeek::load(SnapshotReader& r) 
+{ r.get(rep, s, e, moy, wom, dow, back); }
+
+// Construct PD for a year, specifying months of year, weeks of month. Weeks 
+// past the end of a month roll over into the following months.
 YearPD_MonthWeek::YearPD_MonthWeek(
         const rj::Value& det, 
         const Date& s, 
         const Date& e)
-    : PD{det, s, e} {
-    date::years yInc{rep};
-    for (const rj::Value& m : det["months-of-year"].GetArray()) {
-        for (const rj::Value& w : det["weeks-of-month"].GetArray()) {
-            for (const rj::Value& d : det["days-of-week"].GetArray()) {
-                for (Date curr = s; curr <= e; curr += yInc) {
-                    Date next{curr.year()/
-                            m.GetInt()/
-                            date::weekday(d.GetInt())[w.GetInt()]};
-                    if (s <= next && next <= e && next.ok())
-                        dl.push_back(next);
+    : PD{det, s, e}, 
+      moy{parseIntArr(det, "months-of-year")}, 
+      wom{parseIntArr(det, "weeks-of-month")}, 
+      dow{parseIntArr(det, "days-of-week")} 
+{ back = std::max(0L, maxOf(moy)-1) / 12 + 2; }
+
+// Return whether the year pattern is active on date d
+bool YearPD_MonthWeek::active(const Date& d) const {
+    if (d < s || e < d)
+        return false;
+    long n = yearsBetween(s, d);
+    return anyYearStep(s, e, rep, n-back, n+1, [&](const Date& curr) {
+        for (int m : moy)
+            for (int w : wom)
+                for (int x : dow)
+                    if (Date{curr.year()/m/date::weekday(x)[w]} == d)
+                        return true;
+        return false;
+    });
+}
+
+// Call f for each date of the year pattern between lo and hi
+template<class F>
+void YearPD_MonthWeek::forEach(const Date& lo, const Date& hi, F f) const {
+    long n0 = yearsBetween(s, lo) - back, n1 = yearsBetween(s, hi) + 1;
+    anyYearStep(s, e, rep, n0, n1, [&](const Date& curr) {
+        for (int m : moy) {
+            for (int w : wom) {
+                for (int x : dow) {
+                    Date next{curr.year()/m/date::weekday(x)[w]};
+                    if (lo <= next && next <= hi)
+                        f(next);
                 }
             }
         }
-    }
+        return false;
+    });
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -341,44 +773,70 @@ TPPattern::TPPattern(const rj::Value& pat)
     switch (pat["period"].GetString()[0]) {
         case 'd': case 'D': // Day
             period = TPPattern::Period::DAY;
-            det = std::shared_ptr<PD>{new DayPD{pd, s, e}};
+            det = DayPD{pd, s, e};
             break;
         case 'w': case 'W': // Week
             period = TPPattern::Period::WEEK;
-            det = std::shared_ptr<PD>{new WeekPD{pd, s, e}};
+            det = WeekPD{pd, s, e};
             break;
         case 'm': case 'M': // Month
             period = TPPattern::Period::MONTH;
             if (pd.HasMember("days-of-month"))
-                det = std::shared_ptr<PD>{new MonthPD_Day{pd, s, e}};
+                det = MonthPD_Day{pd, s, e};
             else
-                det = std::shared_ptr<PD>{new MonthPD_Week{pd, s, e}};
+                det = MonthPD_Week{pd, s, e};
             break;
         case 'y': case 'Y': // Year
             period = TPPattern::Period::YEAR;
             if (pd.HasMember("days-of-year"))
-                det = std::shared_ptr<PD>{new YearPD_Day{pd, s, e}};
+                det = YearPD_Day{pd, s, e};
             else if (pd.HasMember("weeks-of-year")) // members: days-of-week
-                det = std::shared_ptr<PD>{new YearPD_Week{pd, s, e}};
+                det = YearPD_Week{pd, s, e};
             else if (pd.HasMember("days-of-month")) // members: months-of-year
-                det = std::shared_ptr<PD>{new YearPD_MonthDay{pd, s, e}};
+                det = YearPD_MonthDay{pd, s, e};
             else // members: months-of-year, weeks-of-month, days-of-week
-                det = std::shared_ptr<PD>{new YearPD_MonthWeek{pd, s, e}};
+                det = YearPD_MonthWeek{pd, s, e};
             break;
         default:
             std::cerr << "TPPattern: Period " << pat["period"].GetString() 
                       << " not recognized" << std::endl;
-            std::exit(1);
+            exitOnError();
     }
 
 }
 
-// Return the list of dates 
-const DateList& TPPattern::dates() const { return det->dates(); }
+// Return whether the pattern is active on date d. Dates that are not cached 
+// by compile() are evaluated by the period details.
+bool TPPattern::contains(const Date& d) const {
+    if (dates.covers(d))
+        return dates.contains(d);
+    return std::visit([&](const auto& pd) { return pd.active(d); }, det);
+}
+
+// Cache the dates of the pattern between the dates hs and he (inclusive), 
+// e.g., the days of the simulation
+void TPPattern::compile(const Date& hs, const Date& he) {
+    dates = DateBitset{hs, he};
+
+    Date lo = std::max(s, hs), hi = std::min(e, he);
+    if (lo <= hi) {
+        std::visit([&](const auto& pd) {
+            pd.forEach(lo, hi, [&](const Date& d) { dates.insert(d); });
+        }, det);
+    }
+}
+
+// Write the time profile pattern into the snapshot
+void TPPattern::save(SnapshotWriter& w) const 
+{ w.put(s, e, period, det); }
+
+// Read the time profile pattern from the snapshot
+void TPPattern::load(SnapshotReader& r) 
+{ r.get(s, e, period, det); }
 
-// Print the time profile pattern
+// Print the time profile pattern (the cached dates)
 std::ostream& operator<<(std::ostream& oss, const TPPattern& p) 
-{ return p.det->print(oss); }
+{ return oss << p.dates.dates(); }
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -453,8 +911,7 @@ TimePeriod TimeProfile::query(const DateTime& eta, bool useETA) {
     const Date& d = eta.date();
     const Time& t = eta.time();
     for (TimeProfileEntry& e : tp) {
-        const DateList& dl = e.pat.dates();
-        if (std::find(dl.begin(), dl.end(), d) != dl.end()) {
+        if (e.pat.contains(d)) {
             if (useETA) {
                 Time start = e.start.sample();
                 if (t + e.start.stdev() < start) // current time is too early
@@ -500,6 +957,77 @@ TimePeriod TimeProfile::query(const DateTime& eta, bool useETA) {
     return TimePeriod{}; // Nothing found.
 }
 
+// Return whether the time profile is active at datetime dt, i.e., whether dt 
+// is within an active window of its day. The windows of a day are those of 
+// the entries active on the day, between their mean start and end times (see 
+// activeEntry()); unlike query(), nothing is sampled.
+bool TimeProfile::active(const DateTime& dt) const {
+    const Date& d = dt.date();
+    const Time& t = dt.time();
+    if (days.covers(d)) {
+        if (!days.contains(d))
+            return false;
+        Index k = (date::sys_days{d} - first).count();
+        for (Index i = offsets[k]; i < offsets[k+1]; ++i) {
+            if (windows[i].first <= t && t <= windows[i].second)
+                return true;
+        }
+        return false;
+    }
+
+    for (std::size_t i = 0; i < tp.size(); ++i) {
+        if (activeEntry(i, d) && tp[i].start.mean() <= t && 
+                t <= tp[i].end.mean())
+            return true;
+    }
+    return false;
+}
+
+// Return whether the pattern of entry i contains date d, and its mean start 
+// and end times leave the mean required time
+bool TimeProfile::activeEntry(Index i, const Date& d) const {
+    const TimeProfileEntry& e = tp[i];
+    return e.pat.contains(d) && 
+           e.end.mean() - e.req.mean() - e.start.mean() > Time{0};
+}
+
+// Cache the dates of each pattern between the dates hs and he (inclusive), 
+// and compile the activity calendar of those days
+void TimeProfile::compile(const Date& hs, const Date& he) {
+    for (TimeProfileEntry& e : tp)
+        e.pat.compile(hs, he);
+
+    first = hs;
+    days = DateBitset{hs, he};
+    offsets.assign(1, 0);
+    windows.clear();
+    for (date::sys_days d = hs; d <= date::sys_days{he}; d += date::days{1}) {
+        for (std::size_t i = 0; i < tp.size(); ++i) {
+            if (activeEntry(i, d)) {
+                days.insert(d);
+                windows.emplace_back(tp[i].start.mean(), tp[i].end.mean());
+            }
+        }
+        offsets.push_back(windows.size());
+    }
+}
+
+// Write the time profile into the snapshot
+void TimeProfile::save(SnapshotWriter& w) const 
+{ w.put(tp); }
+
+// Read the time profile from the snapshot
+void TimeProfile::load(SnapshotReader& r) 
+{ r.get(tp); }
+
+// Write the time profile entry into the snapshot
+void TimeProfile::TimeProfileEntry::save(SnapshotWriter& w) const 
+{ w.put(pat, start, end, req, recur); }
+
+// Read the time profile entry from the snapshot
+void TimeProfile::TimeProfileEntry::load(SnapshotReader& r) 
+{ r.get(pat, start, end, req, recur); }
+
 // Print the time profile entries
 std::ostream& operator<<(std::ostream& oss, const TimeProfile& tp) {
     oss << "TimeProfile(";
@@ -519,4 +1047,74 @@ std::ostream& operator<<(std::ostream& oss, const TimeProfile& tp) {
     return oss;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// Time Profile Pool
+
+// Returns the static pool of time profiles
+TimeProfilePool& timeProfiles() {
+    static TimeProfilePool pool;
+    return pool;
+}
+
+// Return the number of distinct time profiles
+int TimeProfilePool::size() const { return entries.size(); }
+
+// Return a reference to the time profile with the given handle
+TimeProfile& TimeProfilePool::operator[](Index h) { return entries[h]; }
+
+// Return the handle of the time profile read from the rapidjson value. The 
+// profile is only parsed if an identical one is not already in the pool.
+Index TimeProfilePool::add(const rj::Value& profileList) {
+    rj::StringBuffer buf;
+    rj::Writer<rj::StringBuffer> writer{buf};
+    profileList.Accept(writer);
+
+    std::lock_guard<std::mutex> lock{m};
+    std::pair<std::unordered_map<std::string, Index>::iterator, bool> it = 
+            loc.emplace(buf.GetString(), entries.size());
+    if (it.second)
+        entries.push_back(TimeProfile{profileList});
+    return it.first->second;
+}
+
+// Cache the dates of all time profiles between the dates hs and he 
+void TimeProfilePool::compile(const Date& hs, const Date& he) {
+    for (TimeProfile& tp : entries)
+        tp.compile(hs, he);
+}
+
+// Write the time profiles (and their handles) into the snapshot
+void TimeProfilePool::save(SnapshotWriter& w) const 
+{ w.put(loc, entries); }
+
+// Read the time profiles (and their handles) from the snapshot, in place of 
+// the time profiles that have been read
+void TimeProfilePool::load(SnapshotReader& r) 
+{ r.get(loc, entries); }
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// Time Profile Ref
+
+// Default Constructor (the empty time profile)
+TimeProfileRef::TimeProfileRef() {}
+
+// Read the profile list from the rapidjson value into the pool
+TimeProfileRef::TimeProfileRef(const rj::Value& profileList) 
+    : h{timeProfiles().add(profileList)} {}
+
+// Query the referenced time profile (see TimeProfile::query())
+TimePeriod TimeProfileRef::query(const DateTime& eta, bool useETA) const 
+{ return h < 0 ? TimePeriod{} : timeProfiles()[h].query(eta, useETA); }
+
+// Return whether the referenced time profile is active at datetime dt (see 
+// TimeProfile::active()); the empty time profile is never active
+bool TimeProfileRef::active(const DateTime& dt) const 
+{ return h >= 0 && timeProfiles()[h].active(dt); }
+
+// Print the referenced time profile
+std::ostream& operator<<(std::ostream& oss, const TimeProfileRef& t) 
+{ return t.h < 0 ? oss << "TimeProfile()" : oss << timeProfiles()[t.h]; }
+
 #endif // UTILS_TIME_PROFILE_HPP
@@ -24,6 +24,7 @@ using ConfigMap    = std::map<Section, SectionMap>;
 //General
 using Filename        = std::string;
 using Index           = int;
+using IndexList       = std::vector<Index>;
 using Description     = std::string;
 using Probability     = double; 
 using ProbabilityList = std::vector<Probability>;
@@ -37,6 +38,7 @@ using SensorID     = int;
 using MetaPersonID = int;
 using MetaEventID  = int;
 using MetaSensorID = int;
+using ClusterID    = int;
 
 using PersonIDIndexMap     = std::map<PersonID, Index>;
 using EventIDIndexMap      = std::map<EventID, Index>;